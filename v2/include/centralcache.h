@@ -2,21 +2,14 @@
 #define __MEMORYPOOL_CENTRALCACHE_H__
 
 #include "common.h"
+#include "pagemap.h"
+#include "spinlock.h"
 #include <array>
 #include <atomic>
-#include <chrono>
+#include <cstdint>
 
 namespace MemoryPool_V2
 {
-// 使用无锁的span信息存储
-struct SpanTracker
-{
-    std::atomic<void *> spanAddr{nullptr}; // span的起始地址
-    std::atomic<size_t> numPages{0};       // span包含的页数
-    std::atomic<size_t> blockCount{0};     // span 包含的block数
-    std::atomic<size_t> freeCount{0};      // 记录span中的空闲块数
-};
-
 class CentralCache
 {
   public:
@@ -26,33 +19,87 @@ class CentralCache
         return &instance;
     }
 
-    void *fetchRange(size_t index);
-    void returnRange(void *start, size_t size, size_t bytes);
+    // 批量获取：一次加锁最多取出 batchNum 个内存块，通过 start/end 返回链表首尾，返回值为实际块数
+    // owner 为领取线程的远程释放队列，只在 span 由该线程独占时记录到 span 上
+    size_t fetchRange(void *&start, void *&end, size_t batchNum, size_t index, RemoteFreeQueue *owner = nullptr);
+    // 批量归还：从 start 开始归还 size / 块大小 个块，返回链表中剩余部分的头（没有剩余时为 nullptr）
+    // 归还时本来就要逐块遍历，调用方借此切分链表，不必再单独找切分点
+    void *returnRange(void *start, size_t size, size_t index);
+    // 数组形式的批量获取/归还，块地址按顺序读写 batch，不经过块内的链表指针
+    size_t fetchBatch(void **batch, size_t batchNum, size_t index, RemoteFreeQueue *owner = nullptr);
+    void returnBatch(void *const *batch, size_t num, size_t index);
+    // 大小类 index 的锁统计，用于观察中心缓存的竞争情况
+    LockStats lockStats(size_t index) const;
+
+    // 每个大小类最多暂留一个空闲 span，所有大小类合计不超过该页数（8MB），超出时 span 立即交还 PageCache
+    static const size_t MAX_IDLE_PAGES = 2048;
+    // 推进中心缓存的纪元，由后台回收线程每个周期调用一次
+    void advanceEpoch()
+    {
+        m_epoch.fetch_add(1, std::memory_order_relaxed);
+    }
+    // 把空闲至少 minAgeEpochs 个纪元的 span 交还 PageCache，一次至多 maxSpans 个，返回实际交还的个数
+    // 各大小类轮流处理，下次调用从上次停下的位置继续
+    size_t reclaimIdleSpans(uint64_t minAgeEpochs, size_t maxSpans);
+    // 立即交还所有空闲 span
+    void releaseIdleSpans()
+    {
+        reclaimIdleSpans(0, SIZE_MAX);
+    }
+    // 当前暂留的空闲 span 总页数
+    size_t idlePages() const
+    {
+        return m_idlePages.load(std::memory_order_relaxed);
+    }
 
   private:
     CentralCache();
     CentralCache(const CentralCache &) = delete;
     CentralCache &operator=(const CentralCache &) = delete;
-    void init();
-    // 从页缓存获取内存
-    void *fetchFromPageCache(size_t size);
-    SpanTracker *getSpanTracker(void *blockAddr);
-    void updateSpanFreeCount(SpanTracker *tracker, size_t newFreeBlocks, size_t index);
-
-  private:
-    std::array<std::atomic<void *>, FREE_LIST_SIZE> m_centralFreeList;
-    std::array<std::atomic_flag, FREE_LIST_SIZE> m_locks;
-    std::array<SpanTracker, 1024> m_spanTrackers;
-    std::atomic<size_t> m_spanCount{0};
+    // 从页缓存获取一个按大小类 index 切分的span
+    Span *fetchFromPageCache(size_t index);
+    // 更新 span 的归属：dedicated 表示领取前 span 没有块在外面，调用方持有该大小类的锁
+    static void updateOwner(Span *span, RemoteFreeQueue *owner, bool dedicated);
+    // partialSpans 为空时补充一个 span：先取 idleSpans，没有再向页缓存申请；调用方持有该大小类的锁
+    bool refillPartial(size_t index);
+    // 把经 next 串起的 span 逐个交还 PageCache，调用方不持有大小类的锁
+    static void releaseSpans(Span *spans);
+    // span 还有可领取的块：空闲链表非空，或还有未切分的部分
+    static bool hasFreeBlocks(const Span *span)
+    {
+        return span->freeList != nullptr || span->carvedCount < span->blockCount;
+    }
+    // 从 span 中取出至多 batchNum 个块（先取空闲链表，再从未切分部分切出），接到 [start, end] 链表尾部
+    size_t fetchFromSpan(Span *span, void *&start, void *&end, size_t batchNum);
+    // 同上，块地址写入 batch
+    size_t fetchFromSpan(Span *span, void **batch, size_t batchNum);
+    // 把一个块放回所属 span，调用方持有该大小类的锁
+    // span 全部归还时放入 idleSpans，替换下来的旧空闲 span 以及超出页数上限的 span 串到 released 上，
+    // 由调用方解锁后交还 PageCache
+    void returnBlock(void *ptr, size_t index, Span *&released);
 
-    // 延迟机制
-    static const size_t MAX_DELAY_COUNT = 48;                                            // 最大延迟计数
-    std::array<std::atomic<size_t>, FREE_LIST_SIZE> m_delayCounts;                       // 每个大小类的延迟计数
-    std::array<std::chrono::steady_clock::time_point, FREE_LIST_SIZE> m_lastReturnTimes; // 上次归还时间
-    static const std::chrono::milliseconds DELAY_INTERVAL;                               // 延迟间隔
+    // span 双向链表操作
+    static void pushSpan(Span *&list, Span *span);
+    static void removeSpan(Span *&list, Span *span);
 
-    bool isDelayReturn(size_t index, size_t currentCount, std::chrono::steady_clock::time_point currentTime);
-    void performDelayReturn(size_t index);
+  private:
+    // 每个大小类按 span 组织：
+    // partialSpans 中的 span 还有空闲块，emptySpans 中的 span 已没有空闲块（所有块都在外面）
+    // idleSpans 中至多一个 span，其所有块都已归还，freeEpoch 记录其变为空闲时的中心缓存纪元
+    // 块归还到所属 span，span 在链表间移动；空闲 span 优先被复用，被更新的空闲 span 替换或空闲久了才交还 PageCache
+    // 每个大小类的锁与链表头独占缓存行，相邻大小类之间不会伪共享
+    struct alignas(CACHE_LINE_SIZE) CentralFreeList
+    {
+        SpinLock lock;
+        Span *partialSpans = nullptr;
+        Span *emptySpans = nullptr;
+        Span *idleSpans = nullptr;
+    };
+    std::array<CentralFreeList, FREE_LIST_SIZE> m_lists;
+    std::atomic<uint64_t> m_epoch{0};
+    std::atomic<size_t> m_idlePages{0};       // 所有大小类 idleSpans 的总页数
+    std::atomic<size_t> m_reclaimCursor{0};   // reclaimIdleSpans 下次开始的大小类
+    PageMap *m_pageMap = PageMap::getInstance(); // 块地址 -> span 元数据
 };
 }; // namespace MemoryPool_V2
-#endif //__MEMORYPOOL_CENTRALCACHE_H__
\ No newline at end of file
+#endif //__MEMORYPOOL_CENTRALCACHE_H__
@@ -3,13 +3,96 @@
 
 #include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// 把 addr 所在的缓存行预取到 CPU 缓存，不支持的编译器上为空操作
+#if defined(__GNUC__) || defined(__clang__)
+#define MEMORYPOOL_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define MEMORYPOOL_PREFETCH(addr) ((void)(addr))
+#endif
 
 namespace MemoryPool_V2
 {
 // 对其数和大小定义
 constexpr size_t ALIGNMENT = 8;
 constexpr size_t MAX_BYTES = 256 * 1024; // 256KB
-constexpr size_t FREE_LIST_SIZE = MAX_BYTES / ALIGNMENT;
+constexpr size_t PAGE_SHIFT = 12; // 页大小 4KB
+constexpr size_t MAX_BATCH_NUM = 64; // 单次批量搬运的最大块数
+constexpr size_t CACHE_LINE_SIZE = 64; // 按缓存行对齐的数据结构使用，避免伪共享
+
+// 相邻大小类之间的步长：128 字节以内按 16 字节递增，之后每个 2 的幂区间均分为 8 档，
+// 因此除最小的几个类外，向上取整带来的内部浪费不超过 12.5%
+constexpr size_t sizeClassStep(size_t size)
+{
+    if (size < 16)
+    {
+        return 8;
+    }
+    if (size < 128)
+    {
+        return 16;
+    }
+    size_t power = 1;
+    while (power * 2 <= size)
+    {
+        power *= 2;
+    }
+    return power / 8;
+}
+
+constexpr size_t countSizeClasses()
+{
+    size_t count = 0;
+    for (size_t size = ALIGNMENT; size <= MAX_BYTES; size += sizeClassStep(size))
+    {
+        count++;
+    }
+    return count;
+}
+
+constexpr size_t FREE_LIST_SIZE = countSizeClasses(); // 大小类个数
+
+// ThreadCache 与 CentralCache 之间单次批量搬运的块数上限
+// 小对象一次多搬一些，大对象少搬一些，每批大约 64KB
+constexpr size_t batchMoveSize(size_t size)
+{
+    if (size == 0)
+    {
+        return 0;
+    }
+    size_t num = (64 * 1024) / size;
+    if (num < 2)
+    {
+        num = 2;
+    }
+    if (num > MAX_BATCH_NUM)
+    {
+        num = MAX_BATCH_NUM;
+    }
+    return num;
+}
+
+// 大小类从 PageCache 领取的 span 页数（与 tcmalloc 的大小类生成方式相同）：
+// 1. 逐页增加，直到切分后末尾浪费不超过 span 的 1/8
+// 2. 一个 span 至少能提供一次批量搬运的块数，单次补充不必跨多个 span
+// 3. 不超过页缓存按页数分桶的上限 MAX_SPAN_PAGES
+constexpr size_t MAX_SPAN_PAGES = 128;
+constexpr size_t spanPagesFor(size_t size)
+{
+    constexpr size_t pageSize = size_t(1) << PAGE_SHIFT;
+    size_t bytes = 0;
+    do
+    {
+        bytes += pageSize;
+        while (bytes % size > bytes / 8)
+        {
+            bytes += pageSize;
+        }
+    } while (bytes / size < batchMoveSize(size) && bytes < MAX_SPAN_PAGES * pageSize);
+    return bytes / pageSize < MAX_SPAN_PAGES ? bytes / pageSize : MAX_SPAN_PAGES;
+}
 
 // 内存块头部信息
 struct BlockHeader
@@ -19,6 +102,58 @@ struct BlockHeader
     BlockHeader *next; // 指向下一个内存块
 };
 
+// 大小类查找表：
+// 1. classSize 记录每个大小类的块大小，spanPages 记录每个大小类 span 的页数
+// 2. 1024 字节以内按 8 字节粒度查表，以上按 128 字节粒度查表
+struct SizeClassTable
+{
+    static constexpr size_t SMALL_LIMIT = 1024;
+    static constexpr size_t SMALL_SHIFT = 3;
+    static constexpr size_t LARGE_SHIFT = 7;
+    static constexpr size_t SMALL_LENGTH = (SMALL_LIMIT >> SMALL_SHIFT) + 1;
+    static constexpr size_t LARGE_LENGTH = (MAX_BYTES >> LARGE_SHIFT) + 1;
+
+    size_t classSize[FREE_LIST_SIZE]{};
+    uint8_t spanPages[FREE_LIST_SIZE]{};
+    uint8_t smallIndex[SMALL_LENGTH]{};
+    uint8_t largeIndex[LARGE_LENGTH]{};
+
+    constexpr SizeClassTable()
+    {
+        size_t index = 0;
+        for (size_t size = ALIGNMENT; size <= MAX_BYTES; size += sizeClassStep(size))
+        {
+            spanPages[index] = static_cast<uint8_t>(spanPagesFor(size));
+            classSize[index++] = size;
+        }
+
+        // 每个查表粒度映射到第一个能容纳它的大小类
+        index = 0;
+        for (size_t i = 0; i < SMALL_LENGTH; i++)
+        {
+            size_t bytes = i << SMALL_SHIFT;
+            while (classSize[index] < bytes)
+            {
+                index++;
+            }
+            smallIndex[i] = static_cast<uint8_t>(index);
+        }
+        index = 0;
+        for (size_t i = 0; i < LARGE_LENGTH; i++)
+        {
+            size_t bytes = i << LARGE_SHIFT;
+            while (classSize[index] < bytes)
+            {
+                index++;
+            }
+            largeIndex[i] = static_cast<uint8_t>(index);
+        }
+    }
+};
+
+static_assert(FREE_LIST_SIZE <= 256, "size class index must fit in uint8_t");
+inline constexpr SizeClassTable SIZE_CLASS_TABLE{};
+
 // 大小类管理
 class SizeClass
 {
@@ -29,17 +164,76 @@ class SizeClass
         return (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
     }
 
+    // 查表得到大小类下标，bytes 不能超过 MAX_BYTES
     static size_t getIndex(size_t bytes)
     {
-        if (bytes < ALIGNMENT)
+        if (bytes <= SizeClassTable::SMALL_LIMIT)
+        {
+            return SIZE_CLASS_TABLE.smallIndex[(bytes + (1 << SizeClassTable::SMALL_SHIFT) - 1) >>
+                                               SizeClassTable::SMALL_SHIFT];
+        }
+        return SIZE_CLASS_TABLE.largeIndex[(bytes + (1 << SizeClassTable::LARGE_SHIFT) - 1) >>
+                                           SizeClassTable::LARGE_SHIFT];
+    }
+
+    // 大小类对应的实际块大小
+    static size_t classSize(size_t index)
+    {
+        return SIZE_CLASS_TABLE.classSize[index];
+    }
+
+    // 块大小是 alignment 整数倍的最小大小类（span 按页对齐，这类块天然对齐）
+    // 找不到时返回 FREE_LIST_SIZE
+    static size_t alignedIndex(size_t size, size_t alignment)
+    {
+        for (size_t index = getIndex(size); index < FREE_LIST_SIZE; index++)
         {
-            bytes = ALIGNMENT;
+            if (classSize(index) % alignment == 0)
+            {
+                return index;
+            }
         }
-        // 向上取整
-        return (bytes + ALIGNMENT - 1) / ALIGNMENT - 1;
+        return FREE_LIST_SIZE;
+    }
+
+    // 大小类对应的 span 页数
+    static size_t spanPages(size_t index)
+    {
+        return SIZE_CLASS_TABLE.spanPages[index];
+    }
+
+    // ThreadCache 与 CentralCache 之间单次批量搬运的块数上限
+    static size_t numMoveSize(size_t size)
+    {
+        return batchMoveSize(size);
     }
 };
 
+// 小块内存的清零标记：块在自由链表中时第一个字存放链表指针，块大小至少两个字时，
+// 第二个字在块被释放或从内容不确定的 span 切出时写入非 0 标记。分配清零内存时第二个字仍为 0，
+// 说明块切自已清零的 span 且从未交给过用户，除链表指针外全为 0，只需清除第一个字
+constexpr uintptr_t DIRTY_BLOCK_MARK = 1;
+
+inline void markBlockDirty(void *block, size_t blockSize)
+{
+    if (blockSize >= 2 * sizeof(void *))
+    {
+        static_cast<uintptr_t *>(block)[1] = DIRTY_BLOCK_MARK;
+    }
+}
+
+// 把刚分配的小块的前 size 字节清零
+inline void zeroBlock(void *block, size_t size)
+{
+    uintptr_t *words = static_cast<uintptr_t *>(block);
+    if (size > sizeof(void *) && words[1] == 0)
+    {
+        words[0] = 0;
+        return;
+    }
+    memset(block, 0, size);
+}
+
 } // namespace MemoryPool_V2
 
-#endif // __MEMORYPOOL_COMMON_H__
\ No newline at end of file
+#endif // __MEMORYPOOL_COMMON_H__
@@ -0,0 +1,91 @@
+#ifndef __MEMORYPOOL_CPUCACHE_H__
+#define __MEMORYPOOL_CPUCACHE_H__
+
+#include "common.h"
+#include "spinlock.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace MemoryPool_V2
+{
+// 每 CPU 缓存：与 ThreadCache 接口相同的另一种前端，按当前运行的 CPU 而不是线程缓存内存块
+// 线程数远多于 CPU 数时，缓存的内存总量只与 CPU 数有关，空闲线程也不会占住内存块
+// CPU 编号优先从 glibc 注册的 rseq 区域读取，否则使用 sched_getcpu；都取不到时退回 ThreadCache
+// rseq 只用来读取 CPU 编号，并没有用 rseq 临界区提交修改：线程在访问某个 CPU 的缓存期间可能被迁移，
+// 因此每个 CPU 的缓存仍有一把自适应锁，正常情况下无竞争。锁只保护 slab 自身的链表，
+// 向传输缓存/中心缓存补充或归还时先释放，下层的慢路径不会阻塞同一 CPU 上的其他线程
+class CpuCache
+{
+  public:
+    static const size_t MAX_CPUS = 1024;
+
+    static CpuCache *getInstance()
+    {
+        static CpuCache instance;
+        return &instance;
+    }
+
+    // 是否启用每 CPU 缓存，默认关闭，可通过环境变量 MEMORYPOOL_PERCPU=1 开启
+    static bool isEnabled()
+    {
+        return enabledFlag().load(std::memory_order_relaxed);
+    }
+    static void setEnabled(bool enable)
+    {
+        enabledFlag().store(enable, std::memory_order_relaxed);
+    }
+    // 当前线程能否取得 CPU 编号，取不到时各接口退回 ThreadCache
+    static bool isAvailable()
+    {
+        return currentCpu() >= 0;
+    }
+
+    // 与 ThreadCache 相同的分配/释放接口
+    void *allocate(size_t size);
+    void deallocate(void *ptr, size_t size);
+    void deallocate(void *ptr);
+    void *allocateAligned(size_t size, size_t alignment);
+    void *allocateZeroed(size_t size);
+    // 将所有 CPU 缓存的内存块归还给中心缓存
+    void flush();
+
+  private:
+    // 单个 CPU 的缓存，独占一个页，避免不同 CPU 之间伪共享
+    struct CpuSlab
+    {
+        SpinLock lock;
+        std::array<void *, FREE_LIST_SIZE> freeList{};
+        std::array<uint32_t, FREE_LIST_SIZE> freeListSize{};
+    };
+
+    CpuCache() = default;
+    CpuCache(const CpuCache &) = delete;
+    CpuCache &operator=(const CpuCache &) = delete;
+
+    static std::atomic<bool> &enabledFlag();
+    static int currentCpu();
+    // 当前 CPU 的缓存，首次使用时创建，取不到 CPU 编号时返回 nullptr
+    CpuSlab *currentSlab();
+    static void lock(CpuSlab *slab)
+    {
+        slab->lock.lock();
+    }
+    static void unlock(CpuSlab *slab)
+    {
+        slab->lock.unlock();
+    }
+    // 把 slab 中 index 类的前 count 个块摘下，返回链表头，调用方持有 slab 锁
+    static void *detachBlocks(CpuSlab *slab, size_t index, size_t count);
+    // 把摘下的 count 个块归还传输缓存/中心缓存，调用方不持有 slab 锁
+    static void releaseBlocks(void *list, size_t index, size_t count);
+
+  private:
+    std::array<std::atomic<CpuSlab *>, MAX_CPUS> m_slabs{};
+    std::mutex m_createMutex; // 串行化 slab 的创建
+};
+} // namespace MemoryPool_V2
+
+#endif //__MEMORYPOOL_CPUCACHE_H__
@@ -2,7 +2,12 @@
 #define __MEMORYPOOL_MEMORYPOOL_H__
 
 #include "threadcache.h"
+#include "centralcache.h"
+#include "cpucache.h"
 #include "common.h"
+#include "pagecache.h"
+#include "scavenger.h"
+#include "transfercache.h"
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -16,7 +21,8 @@ class MemoryPool
     // Original void* interface (kept for backward compatibility)
     static void *allocate(size_t size)
     {
-        void* ptr = ThreadCache::getInstance()->allocate(size);
+        void* ptr = CpuCache::isEnabled() ? CpuCache::getInstance()->allocate(size)
+                                          : ThreadCache::getInstance()->allocate(size);
         if (!ptr && size > 0) {
             throw std::bad_alloc();
         }
@@ -35,11 +41,122 @@ class MemoryPool
     
     static void deallocate(void *ptr, size_t size)
     {
-        if (ptr) {
+        if (!ptr) {
+            return;
+        }
+        if (CpuCache::isEnabled()) {
+            CpuCache::getInstance()->deallocate(ptr, size);
+        } else {
             ThreadCache::getInstance()->deallocate(ptr, size);
         }
     }
     
+    // 分配并清零（calloc 语义），新申请的内存（包括从中切出、尚未用过的小块）已由系统清零，不会重复 memset
+    static void *allocateZeroed(size_t size)
+    {
+        void* ptr = CpuCache::isEnabled() ? CpuCache::getInstance()->allocateZeroed(size)
+                                          : ThreadCache::getInstance()->allocateZeroed(size);
+        if (!ptr) {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+    
+    // 按 alignment（2 的幂）对齐分配，使用 deallocate(ptr) 释放
+    static void *allocateAligned(size_t size, size_t alignment)
+    {
+        void* ptr = CpuCache::isEnabled() ? CpuCache::getInstance()->allocateAligned(size, alignment)
+                                          : ThreadCache::getInstance()->allocateAligned(size, alignment);
+        if (!ptr) {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+    
+    // 不带大小的释放，大小类从 span 元数据中获取
+    static void deallocate(void *ptr)
+    {
+        if (!ptr) {
+            return;
+        }
+        if (CpuCache::isEnabled()) {
+            CpuCache::getInstance()->deallocate(ptr);
+        } else {
+            ThreadCache::getInstance()->deallocate(ptr);
+        }
+    }
+    
+    // 返回 ptr 实际可用的字节数（所属大小类的块大小，大对象为到 span 末尾的字节数）
+    static size_t usableSize(void *ptr)
+    {
+        return ptr ? ThreadCache::usableSize(ptr) : 0;
+    }
+    
+    // 将当前线程缓存的内存块全部归还给中心缓存，传输缓存中暂存的批次也一并归还，全部空闲的 span 交还 PageCache
+    // 线程退出时会自动归还，长期存活的线程可在空闲前主动调用
+    static void flushThreadCache()
+    {
+        ThreadCache::getInstance()->flush();
+        TransferCache::getInstance()->flush();
+        CentralCache::getInstance()->releaseIdleSpans();
+    }
+    
+    // 切换线程缓存自由链表的布局：enable 为 true 时用指针数组代替块内链表，分配时不再逐块读取链表指针
+    // 对当前线程立即生效，之后创建的线程也使用该布局；也可通过环境变量 MEMORYPOOL_ARRAY_FREELIST=1 开启
+    static void setArrayFreeLists(bool enable)
+    {
+        ThreadCache::setDefaultArrayMode(enable);
+        ThreadCache::getInstance()->setArrayMode(enable);
+    }
+    
+    // 设置所有线程缓存合计的字节预算（默认 32MB）
+    // 频繁超出容量的线程会从预算或空闲线程处获得更多容量，总量保持在预算附近
+    static void setThreadCacheBudget(size_t bytes)
+    {
+        ThreadCache::setCacheBudget(bytes);
+    }
+    
+    // 切换到每 CPU 缓存前端（线程数远多于 CPU 数时更省内存），也可通过环境变量 MEMORYPOOL_PERCPU=1 开启
+    // 两种前端的内存块可以互相释放，切换后原前端中缓存的块仍然有效
+    static void setPerCpuCache(bool enable)
+    {
+        CpuCache::setEnabled(enable);
+    }
+    
+    // 将所有 CPU 缓存的内存块归还给中心缓存，全部空闲的 span 交还 PageCache
+    static void flushCpuCaches()
+    {
+        CpuCache::getInstance()->flush();
+        TransferCache::getInstance()->flush();
+        CentralCache::getInstance()->releaseIdleSpans();
+    }
+    
+    // 启动后台回收线程，按衰减配置把空闲已久的页归还操作系统
+    static void startScavenger(const ScavengerOptions& options = ScavengerOptions())
+    {
+        Scavenger::getInstance()->start(options);
+    }
+    
+    static void stopScavenger()
+    {
+        Scavenger::getInstance()->stop();
+    }
+    
+    // 开关大页模式：页缓存按 2MB 对齐预留大块地址区域并申请透明大页，减少 TLB 未命中
+    static void setHugePageMode(bool enable)
+    {
+        PageCache::getInstance()->setHugePageMode(enable);
+    }
+    
+    // 立即把 PageCache 中所有空闲页归还操作系统，先清空传输缓存并交还中心缓存中的空闲 span
+    // （中心缓存每个大小类平时最多留一个空闲 span 备用，合计不超过 8MB，未启动回收线程时会一直保留到这里或被复用）
+    static void releaseFreeMemory()
+    {
+        TransferCache::getInstance()->flush();
+        CentralCache::getInstance()->releaseIdleSpans();
+        PageCache::getInstance()->releaseIdlePages(0, 0, SIZE_MAX);
+    }
+    
     // 内存池预热接口
     // 预热特定大小的内存块
     static void warmup(size_t size, size_t count = 10)
@@ -64,7 +181,7 @@ class MemoryPool
     {
         // 预热所有从8字节到256KB的大小类
         for (size_t i = 0; i < FREE_LIST_SIZE; ++i) {
-            size_t size = (i + 1) * ALIGNMENT;
+            size_t size = SizeClass::classSize(i);
             warmup(size, countPerSize);
         }
     }
@@ -73,8 +190,8 @@ class MemoryPool
     static void warmupCommon(size_t countPerSize = 10)
     {
         // 预热常用的小内存块（8字节到4KB）
-        for (size_t size = 8; size <= 4096; size += 8) {
-            warmup(size, countPerSize);
+        for (size_t i = 0; i < FREE_LIST_SIZE && SizeClass::classSize(i) <= 4096; ++i) {
+            warmup(SizeClass::classSize(i), countPerSize);
         }
         
         // 预热一些中等大小的内存块
@@ -119,15 +236,12 @@ class MemoryPool
     {
         if (count == 0) return nullptr;
         
-        // Store the array size before the actual array memory
-        size_t* ptr = static_cast<size_t*>(allocate(sizeof(size_t) + count * sizeof(T)));
+        // No size header needed: deallocateArray recovers the size from span metadata
+        T* ptr = static_cast<T*>(allocate(count * sizeof(T)));
         if (!ptr) {
             throw std::bad_alloc();
         }
-        *ptr = count;
-        
-        // Return a pointer to the actual array data
-        return reinterpret_cast<T*>(ptr + 1);
+        return ptr;
     }
     
     // Type-safe nothrow allocation for arrays
@@ -147,11 +261,7 @@ class MemoryPool
     {
         if (arr == nullptr) return;
         
-        // Get the stored array size
-        size_t* ptr = reinterpret_cast<size_t*>(arr) - 1;
-        size_t count = *ptr;
-        
-        deallocate(static_cast<void*>(ptr), sizeof(size_t) + count * sizeof(T));
+        deallocate(static_cast<void*>(arr));
     }
     
     // In-place construction with perfect forwarding
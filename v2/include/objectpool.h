@@ -0,0 +1,86 @@
+#ifndef __MEMORYPOOL_OBJECTPOOL_H__
+#define __MEMORYPOOL_OBJECTPOOL_H__
+
+#include <cstddef>
+#include <new>
+
+namespace MemoryPool_V2
+{
+// 元数据内存直接向系统申请，不经过全局 new/malloc
+void *metadataAlloc(size_t bytes);
+// 累计向系统申请的元数据字节数（span、页表节点、远程释放队列等）
+size_t metadataAllocatedBytes();
+
+// 定长对象池：从大块内存中按需切分，释放的对象挂到空闲链表上复用
+// 不加锁，由调用方保证串行访问
+template <typename T>
+class ObjectPool
+{
+  public:
+    ObjectPool() = default;
+    ObjectPool(const ObjectPool &) = delete;
+    ObjectPool &operator=(const ObjectPool &) = delete;
+
+    T *newObject()
+    {
+        void *obj = nullptr;
+        if (m_freeList != nullptr)
+        {
+            // 优先复用归还的对象
+            obj = m_freeList;
+            m_freeList = *reinterpret_cast<void **>(obj);
+        }
+        else
+        {
+            if (m_remainBytes < OBJECT_SIZE)
+            {
+                m_memory = static_cast<char *>(metadataAlloc(CHUNK_SIZE));
+                if (m_memory == nullptr)
+                {
+                    m_remainBytes = 0;
+                    return nullptr;
+                }
+                m_remainBytes = CHUNK_SIZE;
+            }
+            obj = m_memory;
+            m_memory += OBJECT_SIZE;
+            m_remainBytes -= OBJECT_SIZE;
+        }
+        m_inUse++;
+        return new (obj) T();
+    }
+
+    void deleteObject(T *obj)
+    {
+        if (obj == nullptr)
+        {
+            return;
+        }
+        obj->~T();
+        *reinterpret_cast<void **>(obj) = m_freeList;
+        m_freeList = obj;
+        m_inUse--;
+    }
+
+    // 当前在用的对象数
+    size_t inUse() const
+    {
+        return m_inUse;
+    }
+
+  private:
+    // 对象至少能放下一个指针，并按指针大小对齐
+    static constexpr size_t OBJECT_SIZE =
+        (sizeof(T) < sizeof(void *) ? sizeof(void *) : (sizeof(T) + sizeof(void *) - 1) & ~(sizeof(void *) - 1));
+    // 每次至少申请 128KB，页表节点这类大对象一块只放一个
+    static constexpr size_t CHUNK_SIZE = OBJECT_SIZE > 128 * 1024 ? OBJECT_SIZE : 128 * 1024;
+    static_assert(alignof(T) <= sizeof(void *), "ObjectPool only supports pointer-aligned types");
+
+    char *m_memory = nullptr;  // 当前大块内存中未切分部分的起始地址
+    size_t m_remainBytes = 0;  // 当前大块内存剩余字节数
+    void *m_freeList = nullptr; // 归还对象的空闲链表
+    size_t m_inUse = 0;
+};
+} // namespace MemoryPool_V2
+
+#endif //__MEMORYPOOL_OBJECTPOOL_H__
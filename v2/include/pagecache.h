@@ -2,42 +2,65 @@
 #define __MEMORYPOOL_PAGECACHE_H__
 
 #include "common.h"
-#include <map>
-#include <mutex>
+#include "pageheap.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
 
 namespace MemoryPool_V2
 {
+// 页缓存：由多个页堆分片组成，消除单一全局锁
+// 每个线程固定使用一个分片分配，分片内没有合适的空闲页时先尝试（不等待）其他分片，
+// 仍然没有才在本分片向系统申请；释放时按 span 记录的分片归还，合并只在分片内进行
 class PageCache
 {
   public:
-    static const size_t PAGE_SIZE = 4096;
+    static const size_t NUM_HEAPS = 8;
+    static const size_t PAGE_SIZE = PageHeap::PAGE_SIZE;
+    static const size_t MAX_PAGES = PageHeap::MAX_PAGES;
+    static const size_t LARGE_CACHE_MAX_PAGES = PageHeap::LARGE_CACHE_MAX_PAGES;
+    static const size_t LARGE_CACHE_LIMIT_PAGES = PageHeap::LARGE_CACHE_LIMIT_PAGES;
+    static const size_t HUGE_PAGE_SIZE = PageHeap::HUGE_PAGE_SIZE;
+    static const size_t REGION_SIZE = PageHeap::REGION_SIZE;
     static PageCache *getInstance()
     {
         static PageCache instance;
         return &instance;
     }
-    // 分配 && 释放span
-    void *allocateSpan(size_t numPages);
-    void deallocateSpan(void *ptr, size_t numPages);
+    // 分配 && 释放span，zeroed 非空时返回这段内存是否保证全为 0
+    // （新向系统申请的页，或已 MADV_DONTNEED 的 Clean 页）
+    void *allocateSpan(size_t numPages, bool *zeroed = nullptr);
+    // 页数以 span 元数据为准，ptr 须为 allocateSpan 返回的起始地址
+    void deallocateSpan(void *ptr);
+
+    // 纪元由后台回收线程周期性推进，释放路径只记录当前纪元，不读时钟
+    void advanceEpoch()
+    {
+        m_epoch.fetch_add(1, std::memory_order_relaxed);
+    }
+    // 两阶段衰减：脏页空闲满 dirtyDecay 个纪元后 MADV_FREE，再满 muzzyDecay 个纪元后 MADV_DONTNEED
+    // muzzyDecay 为 0 时直接 MADV_DONTNEED；最多处理 maxPages 页，返回实际处理的页数
+    // 大 span 缓存中空闲满 dirtyDecay 个纪元的 span 先放回页堆参与合并与归还
+    size_t releaseIdlePages(uint64_t dirtyDecay, uint64_t muzzyDecay, size_t maxPages);
+    // 所有分片的统计之和
+    PageCacheStats getStats();
+
+    // 开关大页模式，默认关闭，也可通过环境变量 MEMORYPOOL_HUGEPAGES=1 开启（便于 LD_PRELOAD 使用）
+    // 只影响之后向系统申请的内存，Windows 下无效
+    void setHugePageMode(bool enable);
 
   private:
-    PageCache() = default;
+    PageCache();
     PageCache(const PageCache &) = delete;
     PageCache &operator=(const PageCache &) = delete;
-    void *systemAlloc(size_t numPages);
+    // 当前线程使用的分片，线程首次调用时轮流分配
+    static size_t homeHeap();
 
   private:
-    struct Span
-    {
-        void *pageAddr;  // 页起始地址
-        size_t numPages; // 页数
-        Span *next;      // 链表指针
-    };
-
-    std::map<size_t, Span *> m_freeSpans;
-    std::map<void *, Span *> m_spanMap;
-    std::mutex m_mutex;
+    std::array<PageHeap, NUM_HEAPS> m_heaps;
+    std::atomic<uint64_t> m_epoch{0};
+    std::atomic<size_t> m_cachedPages{0}; // 所有页堆大 span 缓存的总页数
 };
 } // namespace MemoryPool_V2
 
-#endif //__MEMORYPOOL_PAGECACHE_H__
\ No newline at end of file
+#endif //__MEMORYPOOL_PAGECACHE_H__
@@ -0,0 +1,127 @@
+#ifndef __MEMORYPOOL_PAGEHEAP_H__
+#define __MEMORYPOOL_PAGEHEAP_H__
+
+#include "common.h"
+#include "objectpool.h"
+#include "pagemap.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace MemoryPool_V2
+{
+// PageCache 中空闲页的统计信息（单位：页）
+struct PageCacheStats
+{
+    size_t freePages{0};     // 空闲页总数
+    size_t dirtyPages{0};    // 仍占用物理内存的空闲页
+    size_t muzzyPages{0};    // 已 MADV_FREE 的空闲页
+    size_t cleanPages{0};    // 不占物理内存的空闲页
+    size_t releasedPages{0}; // 累计通过 MADV_DONTNEED 归还操作系统的页数
+    size_t cachedPages{0};   // 大 span 缓存中的页（未合并，仍占用物理内存）
+    size_t largeCacheHits{0};   // 大对象分配命中大 span 缓存的次数
+    size_t largeCacheMisses{0}; // 大对象分配未命中、走页堆分配的次数
+    size_t hugePageRegions{0};  // 大页模式下预留的虚拟地址区域数
+};
+
+// 单个页堆：管理一组 span 的分配、分割、合并与归还，内部加锁
+// PageCache 持有多个页堆分片，span 元数据由所属页堆的对象池分配，始终只在该页堆内合并
+class PageHeap
+{
+  public:
+    static const size_t PAGE_SIZE = size_t(1) << PAGE_SHIFT;
+    static const size_t MAX_PAGES = 128; // 不超过该页数的空闲span按页数精确分桶
+    // (MAX_PAGES, LARGE_CACHE_MAX_PAGES] 页的大对象：页数按每个 2 的幂区间 8 档向上取整，
+    // 释放后先整块留在对应档位的缓存中，同样大小的下次分配直接复用，不经过分割与合并
+    static const size_t LARGE_CACHE_MAX_PAGES = 4096;    // 16MB
+    static const size_t LARGE_CACHE_LIMIT_PAGES = 16384; // 所有页堆合计的缓存总量上限 64MB
+    static const size_t LARGE_CACHE_DEPTH = 4;           // 每档最多缓存的 span 数
+    // 大页模式：一次预留 1GB、按 2MB 对齐的虚拟地址区域，span 从中按顺序切出，
+    // 相邻分配落在同一个透明大页内；已切出部分所在的 2MB 区间标记 MADV_HUGEPAGE
+    static const size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+    static const size_t REGION_SIZE = size_t(1) << 30;
+
+    PageHeap() = default;
+    PageHeap(const PageHeap &) = delete;
+    PageHeap &operator=(const PageHeap &) = delete;
+    // 由 PageCache 在构造时调用，epoch 为全局纪元，totalCachedPages 为所有页堆大 span 缓存的总页数
+    void init(uint8_t index, const std::atomic<uint64_t> *epoch, std::atomic<size_t> *totalCachedPages,
+              bool hugePageMode);
+
+    // 分配span，zeroed 含义同 PageCache::allocateSpan
+    // allowSystem 为 false 时只从缓存与空闲链表中分配；wait 为 false 时锁被占用直接返回 nullptr
+    void *allocateSpan(size_t numPages, bool *zeroed, bool allowSystem, bool wait);
+    // span 必须属于本页堆
+    void deallocateSpan(void *ptr);
+    size_t releaseIdlePages(uint64_t dirtyDecay, uint64_t muzzyDecay, size_t maxPages);
+    // 把本页堆的统计累加到 stats
+    void addStats(PageCacheStats &stats);
+    void setHugePageMode(bool enable);
+
+  private:
+    void *allocateLocked(size_t numPages, bool *zeroed, bool allowSystem);
+    Span *newSpan();
+    void *systemAlloc(size_t numPages);
+    // 退还 systemAlloc 申请的内存，只用于申请后无法登记的情况
+    void systemFree(void *ptr, size_t numPages);
+    // 大页模式下从当前区域切出内存，区域不够时预留新区域，失败返回 nullptr
+    void *regionAlloc(size_t numPages);
+    bool reserveRegion();
+    // 当前区域剩余部分作为空闲span放入页堆
+    void retireRegion();
+    // 页数对应的空闲链表，超过 MAX_PAGES 的统一放在 m_largeSpans
+    Span *&freeList(size_t numPages)
+    {
+        return numPages <= MAX_PAGES ? m_freeSpans[numPages] : m_largeSpans;
+    }
+    // 空闲链表为双向链表，插入/摘除均为 O(1)，同时维护非空桶位图
+    void pushFreeSpan(Span *span);
+    void removeFreeSpan(Span *span);
+    // 取出页数 >= numPages 的空闲span：精确分桶按位图首次适配，大span链表按最佳适配
+    Span *popFreeSpan(size_t numPages);
+    // 与地址相邻的空闲span合并，返回合并后的span
+    Span *coalesce(Span *span);
+    // 对 span 的页执行 madvise，成功后更新状态
+    bool systemRelease(Span *span, PageState newState);
+    // 大 span 缓存：档位下标与档位页数（numPages 须在缓存范围内）
+    static size_t largeCacheIndex(size_t numPages);
+    static size_t largeCachePages(size_t numPages);
+    void pushCachedSpan(Span *span);
+    // 从缓存中摘除并放回页堆
+    void evictCachedSpan(Span *span);
+    // 所有页堆的大 span 缓存合计超过总量上限
+    bool overCacheLimit() const
+    {
+        return m_totalCachedPages->load(std::memory_order_relaxed) > LARGE_CACHE_LIMIT_PAGES;
+    }
+
+  private:
+    static const size_t BITMAP_WORDS = MAX_PAGES / 64 + 1;
+
+    // 空闲span按页数分桶，不使用 std::map 以免页缓存内部再经过全局 new
+    std::array<Span *, MAX_PAGES + 1> m_freeSpans{};
+    std::array<uint64_t, BITMAP_WORDS> m_nonEmpty{}; // 第 n 位表示 m_freeSpans[n] 非空
+    Span *m_largeSpans = nullptr;
+    static const size_t LARGE_CACHE_BUCKETS = 41; // (128, 4096) 页共 5 个 2 的幂区间各 8 档，外加 4096 页一档
+    std::array<Span *, LARGE_CACHE_BUCKETS> m_largeCache{};
+    std::array<size_t, LARGE_CACHE_BUCKETS> m_largeCacheCount{};
+    size_t m_cachedPages = 0;                           // 本页堆大 span 缓存的页数
+    std::atomic<size_t> *m_totalCachedPages = nullptr; // 所有页堆合计，用于总量上限
+    size_t m_largeCacheHits = 0;
+    size_t m_largeCacheMisses = 0;
+    bool m_hugePageMode = false;
+    char *m_regionCursor = nullptr; // 当前区域中尚未切出的起始地址
+    char *m_regionEnd = nullptr;
+    char *m_hugeAdvised = nullptr;  // 已标记 MADV_HUGEPAGE 的末尾
+    size_t m_hugePageRegions = 0;
+    PageMap *m_pageMap = PageMap::getInstance();
+    ObjectPool<Span> m_spanPool; // span 元数据从内部对象池分配，合并后回收复用
+    uint8_t m_index = 0;
+    const std::atomic<uint64_t> *m_epoch = nullptr;
+    size_t m_releasedPages = 0;
+    std::mutex m_mutex;
+};
+} // namespace MemoryPool_V2
+
+#endif //__MEMORYPOOL_PAGEHEAP_H__
\ No newline at end of file
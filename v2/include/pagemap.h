@@ -0,0 +1,149 @@
+#ifndef __MEMORYPOOL_PAGEMAP_H__
+#define __MEMORYPOOL_PAGEMAP_H__
+
+#include "common.h"
+#include "objectpool.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace MemoryPool_V2
+{
+class RemoteFreeQueue;
+
+// 空闲页的物理内存状态，按“脏”的程度排序，合并时取较脏者
+// Clean: 未使用过或已 MADV_DONTNEED，不占物理内存且内容为 0
+// Muzzy: 已 MADV_FREE，内核可随时回收，内容不确定
+// Dirty: 刚被释放，仍占用物理内存
+enum class PageState : uint8_t
+{
+    Clean = 0,
+    Muzzy = 1,
+    Dirty = 2,
+};
+
+// span 元数据，由 PageCache 创建，CentralCache 在其上记录小块内存的使用情况
+struct Span
+{
+    void *pageAddr{nullptr}; // 页起始地址
+    size_t numPages{0};      // 页数
+    Span *next{nullptr};     // 链表指针
+    Span *prev{nullptr};     // 双向链表前驱，PageCache/CentralCache 均可 O(1) 摘链
+    bool isUse{false};       // 是否已分配出去（false 表示在 PageCache 空闲链表或大 span 缓存中）
+    bool isCached{false};    // 在 PageCache 的大 span 缓存中，不参与合并
+    // 所属页堆分片。span 元数据始终由同一页堆的对象池创建与回收，该字段只会是这个页堆的编号，
+    // 或对象池重新构造时的初值 NO_HEAP；其他页堆经页表中的旧映射读到它时一定与自己的编号不等，
+    // 因此比对相等之后再读取其他字段时总是持有所属页堆的锁
+    static const uint8_t NO_HEAP = UINT8_MAX;
+    std::atomic<uint8_t> heapIndex{NO_HEAP};
+    PageState state{PageState::Clean}; // 空闲时页的物理内存状态
+    uint64_t freeEpoch{0};             // 进入空闲（或上次状态变化）时的 PageCache 纪元；在 CentralCache 空闲 span 链表中时为中心缓存纪元
+
+    // 以下字段由 CentralCache 维护，受对应大小类的锁保护
+    size_t objSize{0};       // 切分的内存块大小，0 表示未切分
+    size_t blockCount{0};    // span 包含的block数
+    size_t useCount{0};      // 已分配出去（不在本 span 空闲链表中）的块数
+    size_t carvedCount{0};   // 已从 span 起始处按顺序切出的块数，其后的块从未交出过，不在空闲链表中
+    bool zeroed{false};      // span 领取时页内容全为 0，未切出的块仍全为 0，切出时不必写清零标记
+    void *freeList{nullptr}; // span 内部的空闲块链表（只包含切出后又归还的块）
+    // 独占该 span 的线程（交出的块都由它领取）的远程释放队列，其他线程释放块时据此归还给它
+    // 多个线程共享 span 或块经传输缓存转手时为 nullptr，块在释放线程本地回收
+    std::atomic<RemoteFreeQueue *> owner{nullptr};
+};
+
+// 页号 -> Span 的三层基数树，覆盖 48 位虚拟地址空间
+// 使用中的 span 登记所有页，空闲 span 只保证首尾页正确（用于合并）
+// 查询无锁；同一页的写入由持有该页所属页堆锁的调用方串行化，节点分配由内部锁保护
+class PageMap
+{
+  public:
+    static const size_t ADDRESS_BITS = 48;
+    static const size_t PAGE_ID_BITS = ADDRESS_BITS - PAGE_SHIFT;
+    static const size_t LEAF_BITS = 12;
+    static const size_t INTERIOR_BITS = 12;
+    static const size_t ROOT_BITS = PAGE_ID_BITS - LEAF_BITS - INTERIOR_BITS;
+
+    static PageMap *getInstance()
+    {
+        static PageMap instance;
+        return &instance;
+    }
+
+    static size_t pageIdOf(const void *ptr)
+    {
+        return reinterpret_cast<uintptr_t>(ptr) >> PAGE_SHIFT;
+    }
+
+    Span *get(size_t pageId) const
+    {
+        if ((pageId >> PAGE_ID_BITS) != 0)
+        {
+            return nullptr;
+        }
+        Interior *interior = m_root[pageId >> (LEAF_BITS + INTERIOR_BITS)].load(std::memory_order_acquire);
+        if (interior == nullptr)
+        {
+            return nullptr;
+        }
+        Leaf *leaf = interior->leafs[(pageId >> LEAF_BITS) & (INTERIOR_LENGTH - 1)].load(std::memory_order_acquire);
+        if (leaf == nullptr)
+        {
+            return nullptr;
+        }
+        return leaf->spans[pageId & (LEAF_LENGTH - 1)].load(std::memory_order_acquire);
+    }
+
+    Span *get(const void *ptr) const
+    {
+        return get(pageIdOf(ptr));
+    }
+
+    // 为 [pageId, pageId + numPages) 预先分配好中间节点，之后的 set 不会失败，可被多个页堆并发调用
+    bool ensure(size_t pageId, size_t numPages);
+
+    // 调用前必须已 ensure 过对应页
+    void set(size_t pageId, Span *span)
+    {
+        Interior *interior = m_root[pageId >> (LEAF_BITS + INTERIOR_BITS)].load(std::memory_order_relaxed);
+        Leaf *leaf = interior->leafs[(pageId >> LEAF_BITS) & (INTERIOR_LENGTH - 1)].load(std::memory_order_relaxed);
+        leaf->spans[pageId & (LEAF_LENGTH - 1)].store(span, std::memory_order_release);
+    }
+
+    void setRange(size_t pageId, size_t numPages, Span *span)
+    {
+        for (size_t i = 0; i < numPages; i++)
+        {
+            set(pageId + i, span);
+        }
+    }
+
+  private:
+    static const size_t ROOT_LENGTH = size_t(1) << ROOT_BITS;
+    static const size_t INTERIOR_LENGTH = size_t(1) << INTERIOR_BITS;
+    static const size_t LEAF_LENGTH = size_t(1) << LEAF_BITS;
+
+    struct Leaf
+    {
+        std::atomic<Span *> spans[LEAF_LENGTH];
+    };
+
+    struct Interior
+    {
+        std::atomic<Leaf *> leafs[INTERIOR_LENGTH];
+    };
+
+    PageMap() = default;
+    PageMap(const PageMap &) = delete;
+    PageMap &operator=(const PageMap &) = delete;
+
+  private:
+    std::array<std::atomic<Interior *>, ROOT_LENGTH> m_root{};
+    // 节点与 span 一样从元数据对象池分配，不经过全局 new
+    ObjectPool<Interior> m_interiorPool;
+    ObjectPool<Leaf> m_leafPool;
+    std::mutex m_growMutex; // 保护节点分配与对象池
+};
+} // namespace MemoryPool_V2
+
+#endif //__MEMORYPOOL_PAGEMAP_H__
@@ -0,0 +1,88 @@
+#ifndef __MEMORYPOOL_REMOTEFREEQUEUE_H__
+#define __MEMORYPOOL_REMOTEFREEQUEUE_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace MemoryPool_V2
+{
+// 跨线程释放队列（多生产者单消费者，无锁）
+// 每个 ThreadCache 持有一个，其他线程释放由它分配的内存块时压入该队列，
+// 由所属线程在下次未命中时批量取回。队列对象从全局注册表中分配且永不释放，
+// 线程退出后标记为失效，可被新线程复用，因此其他线程持有的指针始终有效。
+class RemoteFreeQueue
+{
+  public:
+    // 队列中积压超过该字节数时，释放方不再压入，改为放到自己的线程缓存
+    static const size_t MAX_PENDING_BYTES = 1024 * 1024;
+
+    // 从注册表获取一个队列
+    static RemoteFreeQueue *acquire();
+    // 使队列失效并归还注册表，返回队列中剩余的块（链表头），由调用方处理并调用 drained
+    static void *release(RemoteFreeQueue *queue);
+
+    bool isAlive() const
+    {
+        return m_head.load(std::memory_order_acquire) != closedMark();
+    }
+
+    // 其他线程调用：压入一个大小为 size 的内存块，队列失效或积压过多时返回 false
+    bool push(void *ptr, size_t size)
+    {
+        // 先预留字节数再让块可见，取回方扣除的字节数总是已经计入，计数不会下溢
+        if (m_pendingBytes.fetch_add(size, std::memory_order_relaxed) + size > MAX_PENDING_BYTES)
+        {
+            m_pendingBytes.fetch_sub(size, std::memory_order_relaxed);
+            return false;
+        }
+        void *head = m_head.load(std::memory_order_relaxed);
+        do
+        {
+            // 失效与取回剩余块是同一次原子交换，看到失效标记即放弃，块不会漏进失效的队列
+            if (head == closedMark())
+            {
+                m_pendingBytes.fetch_sub(size, std::memory_order_relaxed);
+                return false;
+            }
+            *reinterpret_cast<void **>(ptr) = head;
+        } while (!m_head.compare_exchange_weak(head, ptr, std::memory_order_release, std::memory_order_relaxed));
+        return true;
+    }
+
+    // 所属线程调用：一次取出所有积压的块，返回链表头；处理完后调用 drained 扣除这些块的字节数
+    void *popAll()
+    {
+        if (m_head.load(std::memory_order_relaxed) == nullptr)
+        {
+            return nullptr;
+        }
+        return m_head.exchange(nullptr, std::memory_order_acquire);
+    }
+
+    // 扣除经 popAll 或 release 取出的块的总字节数；取出之后才压入的块仍计在队列中
+    void drained(size_t bytes)
+    {
+        m_pendingBytes.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    size_t pendingBytes() const
+    {
+        return m_pendingBytes.load(std::memory_order_relaxed);
+    }
+
+  private:
+    // 失效队列的链表头，不是合法的块地址
+    static void *closedMark()
+    {
+        return reinterpret_cast<void *>(uintptr_t(1));
+    }
+
+  private:
+    std::atomic<void *> m_head{closedMark()};
+    std::atomic<size_t> m_pendingBytes{0};
+    RemoteFreeQueue *m_nextFree{nullptr}; // 注册表中空闲队列链表
+};
+} // namespace MemoryPool_V2
+
+#endif //__MEMORYPOOL_REMOTEFREEQUEUE_H__
@@ -0,0 +1,62 @@
+#ifndef __MEMORYPOOL_SCAVENGER_H__
+#define __MEMORYPOOL_SCAVENGER_H__
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace MemoryPool_V2
+{
+// 后台回收配置
+struct ScavengerOptions
+{
+    std::chrono::milliseconds interval{1000}; // 每个纪元的时长，即扫描周期
+    uint64_t dirtyDecayEpochs = 10;           // 脏页空闲多少个纪元后 MADV_FREE
+    uint64_t muzzyDecayEpochs = 10;           // MADV_FREE 后再过多少个纪元 MADV_DONTNEED，0 表示直接 MADV_DONTNEED
+    size_t maxPagesPerTick = 16384;           // 每个周期最多处理的页数（默认 64MB），限制释放速率
+    uint64_t idleSpanEpochs = 1;              // 中心缓存中的空闲 span 保留多少个纪元后交还 PageCache
+    size_t maxSpansPerTick = 256;             // 每个周期最多从中心缓存交还的 span 数
+};
+
+// 后台回收线程：周期性推进中心缓存与 PageCache 的纪元，把中心缓存中空闲已久的 span 交还 PageCache，
+// 再把 PageCache 中空闲已久的页归还操作系统
+class Scavenger
+{
+  public:
+    static Scavenger *getInstance()
+    {
+        static Scavenger instance;
+        return &instance;
+    }
+
+    // 重复调用会按新配置重启；start 与 stop 可在任意线程并发调用
+    void start(const ScavengerOptions &options = ScavengerOptions());
+    void stop();
+    bool isRunning();
+
+  private:
+    Scavenger() = default;
+    ~Scavenger()
+    {
+        stop();
+    }
+    Scavenger(const Scavenger &) = delete;
+    Scavenger &operator=(const Scavenger &) = delete;
+    void run();
+    // 停止并等待回收线程退出，调用方持有 m_controlMutex
+    void stopThread();
+
+  private:
+    ScavengerOptions m_options;
+    std::thread m_thread;
+    std::mutex m_controlMutex; // 串行化 start/stop，保护 m_thread
+    std::mutex m_mutex;        // 保护 m_options 与 m_running，回收线程等待时持有
+    std::condition_variable m_cond;
+    bool m_running = false;
+};
+} // namespace MemoryPool_V2
+
+#endif //__MEMORYPOOL_SCAVENGER_H__
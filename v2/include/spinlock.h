@@ -0,0 +1,87 @@
+#ifndef __MEMORYPOOL_SPINLOCK_H__
+#define __MEMORYPOOL_SPINLOCK_H__
+
+#include <atomic>
+#include <cstdint>
+
+namespace MemoryPool_V2
+{
+// 锁的统计，持锁时更新，读取时不加锁（数值可能略有滞后）
+struct LockStats
+{
+    uint64_t acquisitions = 0; // 加锁次数
+    uint64_t contentions = 0;  // 第一次尝试没拿到锁的次数
+    uint64_t sleeps = 0;       // 自旋后仍拿不到、进入睡眠等待的次数
+};
+
+// 自适应锁：先用 CPU 的 pause 指令自旋一小段时间，仍拿不到再通过 futex 睡眠等待，
+// 持锁线程解锁时只唤醒一个等待者，避免大量线程反复 sched_yield。非 Linux 平台睡眠退化为 yield
+// 可配合 std::lock_guard 使用
+class SpinLock
+{
+  public:
+    // 进入睡眠前的自旋次数
+    static const int SPIN_COUNT = 128;
+
+    SpinLock() = default;
+    SpinLock(const SpinLock &) = delete;
+    SpinLock &operator=(const SpinLock &) = delete;
+
+    void lock()
+    {
+        uint32_t expected = UNLOCKED;
+        if (!m_state.compare_exchange_strong(expected, LOCKED, std::memory_order_acquire,
+                                             std::memory_order_relaxed))
+        {
+            lockSlow();
+            return;
+        }
+        bump(m_acquisitions);
+    }
+
+    bool try_lock()
+    {
+        uint32_t expected = UNLOCKED;
+        if (!m_state.compare_exchange_strong(expected, LOCKED, std::memory_order_acquire,
+                                             std::memory_order_relaxed))
+        {
+            return false;
+        }
+        bump(m_acquisitions);
+        return true;
+    }
+
+    void unlock()
+    {
+        if (m_state.exchange(UNLOCKED, std::memory_order_release) == SLEEPING)
+        {
+            wake();
+        }
+    }
+
+    LockStats stats() const;
+
+  private:
+    // 0 未加锁，1 已加锁且没有睡眠的等待者，2 已加锁且可能有睡眠的等待者
+    static const uint32_t UNLOCKED = 0;
+    static const uint32_t LOCKED = 1;
+    static const uint32_t SLEEPING = 2;
+
+    void lockSlow();
+    void wait();
+    void wake();
+    // 计数器只在持锁时修改，用普通的读改写即可，不需要原子加
+    static void bump(std::atomic<uint64_t> &counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+  private:
+    std::atomic<uint32_t> m_state{UNLOCKED};
+    std::atomic<uint64_t> m_acquisitions{0};
+    std::atomic<uint64_t> m_contentions{0};
+    std::atomic<uint64_t> m_sleeps{0};
+};
+} // namespace MemoryPool_V2
+
+#endif //__MEMORYPOOL_SPINLOCK_H__
@@ -2,8 +2,10 @@
 #define __MEMORYPOOL_THREADCACHE__H_
 
 #include "common.h"
+#include "remotefreequeue.h"
 
 #include <array>
+#include <atomic>
 
 namespace MemoryPool_V2
 {
@@ -11,9 +13,24 @@ namespace MemoryPool_V2
 class ThreadCache
 {
   public:
+    // 所有线程缓存合计的默认字节预算
+    static const size_t DEFAULT_CACHE_BUDGET = 32 * 1024 * 1024;
+    // 单个线程缓存容量的下限，新线程按此容量起步
+    static const size_t MIN_CACHE_BYTES = 512 * 1024;
+    // 每次扩容（从未分配预算中领取或从其他线程窃取）的字节数
+    static const size_t STEAL_BYTES = 64 * 1024;
+    // 数组布局下每个大小类最多缓存的块数（一个大小类的指针数组正好占一页）
+    static const size_t STACK_CAPACITY = 512;
+
     // 单例
+    // 本线程的缓存析构之后（其他 thread_local 析构函数、pthread key 析构函数、__libc_thread_freeres 中）
+    // 仍可能分配释放，此时返回所有线程共用的直通实例，块直接从中心缓存取出、归还中心缓存，不会滞留
     static ThreadCache *getInstance()
     {
+        if (s_destroyed)
+        {
+            return passThroughInstance();
+        }
         static thread_local ThreadCache instance;
         return &instance;
     }
@@ -21,21 +38,149 @@ class ThreadCache
     // 分配 && 释放
     void *allocate(size_t size);
     void deallocate(void *ptr, size_t size);
+    // 分配并清零；大对象落在新申请或已归还系统的页上、小块切自这样的页且从未交给用户时省去 memset
+    void *allocateZeroed(size_t size);
+    // 按 alignment（2 的幂）对齐分配，可用 deallocate(ptr) 释放
+    void *allocateAligned(size_t size, size_t alignment);
+    // 不带大小的释放：通过页表找到所属 span 得到大小类
+    void deallocate(void *ptr);
+    // 返回 ptr 实际可用的字节数，不是内存池分配的内存返回 0
+    static size_t usableSize(void *ptr);
+    // 将缓存的所有内存块批量归还给中心缓存
+    void flush();
+
+    // 超过 MAX_BYTES 的大对象直接按页向PageCache申请/归还，不经过线程缓存，其他前端（CpuCache）共用
+    static void *allocateLarge(size_t size, bool *zeroed = nullptr);
+    static void *allocateLargeAligned(size_t size, size_t alignment);
+    static void deallocateLarge(void *ptr);
+
+    // 自由链表布局：默认为块内嵌指针的单链表；数组布局把空闲块地址存在每个大小类一个的指针数组（有界栈）中，
+    // 分配时不必读取冷的空闲块，并预取下一个要分配的块，与中心缓存之间按数组批量搬运
+    // 新线程按 setDefaultArrayMode 的设置（默认关闭，可通过环境变量 MEMORYPOOL_ARRAY_FREELIST=1 开启）
+    static void setDefaultArrayMode(bool enable)
+    {
+        arrayModeFlag().store(enable, std::memory_order_relaxed);
+    }
+    // 数组布局下一个大小类的空闲块地址，下标 [0, m_freeListSize) 有效，栈顶为最近释放的块
+    struct FreeStack
+    {
+        void *slots[STACK_CAPACITY];
+    };
+    // 切换本线程的布局，切换前先把缓存的块全部归还中心缓存
+    void setArrayMode(bool enable);
+    bool isArrayMode() const
+    {
+        return m_arrayMode;
+    }
+
+    // 设置所有线程缓存合计的字节预算，已有线程的容量按比例缩放
+    static void setCacheBudget(size_t bytes);
+    static size_t cacheBudget();
+    // 所有线程缓存当前容量之和
+    static size_t totalCacheLimit();
+    // 本线程缓存当前缓存的字节数 / 允许缓存的字节数
+    size_t cachedBytes() const
+    {
+        return m_size;
+    }
+    size_t maxCacheBytes() const
+    {
+        return m_maxSize.load(std::memory_order_relaxed);
+    }
+    // 某个大小类自由链表的当前长度 / 长度上限
+    size_t freeListLength(size_t index) const
+    {
+        return m_freeListSize[index];
+    }
+    size_t maxListLength(size_t index) const
+    {
+        return m_maxLength[index];
+    }
 
   private:
+    struct PassThrough
+    {
+    };
+    // 直通实例不登记、不缓存任何块，也不会析构
+    explicit ThreadCache(PassThrough) : m_passThrough(true)
+    {
+    }
+    static ThreadCache *passThroughInstance();
     ThreadCache()
     {
+        m_maxLength.fill(1);
+        m_overages.fill(0);
+        m_lowMark.fill(0);
+        m_stacks.fill(nullptr);
+        m_arrayMode = arrayModeFlag().load(std::memory_order_relaxed);
+        registerCache();
+    }
+    // 线程退出时归还缓存，避免内存滞留在已退出线程中
+    ~ThreadCache()
+    {
+        // 此后本线程的分配释放改走直通实例
+        s_destroyed = true;
+        // 先让队列失效，之后其他线程释放的块不再压入
+        RemoteFreeQueue *queue = m_remoteQueue;
+        m_remoteQueue = nullptr;
+        pushRemoteBlocks(queue, RemoteFreeQueue::release(queue));
+        flush();
+        releaseStacks();
+        unregisterCache();
     }
     ThreadCache(const ThreadCache &) = delete;
     ThreadCache &operator=(const ThreadCache &) = delete;
-    // 从中心缓存获取/归还内存
+    // 从中心缓存获取内存
     void *fetchFromCentralCache(size_t index);
-    void returnToCentralCache(void *start, size_t size);
-    bool shouldReturnToCentralCache(size_t index);
+    // 数组布局下的未命中：批量取到指针数组中再弹出一个
+    void *fetchIntoStack(size_t index, size_t batchNum);
+    // 从本线程自由链表取出一个块，调用方保证链表非空
+    void *popLocal(size_t index);
+    // 自由链表超过长度上限：归还一批并调整上限
+    void listTooLong(size_t index);
+    // 放回本线程自由链表，必要时归还中心缓存
+    void pushLocal(void *ptr, size_t index);
+    // 取回其他线程释放到远程队列中的内存块
+    void drainRemoteFrees(RemoteFreeQueue *queue);
+    // 把经块内指针串起的远程释放块逐个放回本线程自由链表，并从 queue 的积压字节数中扣除
+    void pushRemoteBlocks(RemoteFreeQueue *queue, void *list);
+    // 缓存字节数超过容量时调用：各大小类归还低水位的一半，再尝试扩容
+    void scavenge();
+    // 归还自由链表头部的 num 个块
+    void releaseBlocks(size_t index, size_t num);
+    // 从未分配的预算中领取容量，没有时轮流从其他线程窃取
+    void increaseCacheLimit();
+    void registerCache();
+    void unregisterCache();
+    static std::atomic<bool> &arrayModeFlag();
+    // 数组布局下某个大小类的指针数组，首次使用时从全局池中取得，线程退出时归还
+    FreeStack *stackFor(size_t index);
+    void releaseStacks();
 
   private:
+    // 本线程的缓存已析构，平凡类型的 thread_local 在线程完全退出前一直可用
+    static inline thread_local bool s_destroyed = false;
+    // 直通实例：分配释放直接与中心缓存交互，可被多个线程同时使用，因此不修改任何成员
+    const bool m_passThrough = false;
     std::array<void *, FREE_LIST_SIZE> m_freeList{nullptr};
     std::array<size_t, FREE_LIST_SIZE> m_freeListSize{0};
+    // 数组布局下各大小类的指针数组，链表布局下不使用
+    std::array<FreeStack *, FREE_LIST_SIZE> m_stacks;
+    bool m_arrayMode = false;
+    // 每个大小类自由链表的长度上限，未命中时增长、反复溢出时缩小
+    std::array<size_t, FREE_LIST_SIZE> m_maxLength;
+    // 上限达到一批之后、两次未命中之间溢出的次数
+    std::array<size_t, FREE_LIST_SIZE> m_overages;
+    // 本线程的远程释放队列，首次向中心缓存取内存时获取
+    RemoteFreeQueue *m_remoteQueue = nullptr;
+    // 自上次回收以来各自由链表长度的最小值，一直未降到 0 的部分说明用不到
+    std::array<size_t, FREE_LIST_SIZE> m_lowMark;
+    // 当前缓存的字节数（仅本线程访问）与允许缓存的字节数（其他线程窃取时会减小）
+    size_t m_size = 0;
+    std::atomic<size_t> m_maxSize{0};
+    // 全局线程缓存链表，窃取容量时遍历
+    ThreadCache *m_next = nullptr;
+    ThreadCache *m_prev = nullptr;
 };
 } // namespace MemoryPool_V2
 
@@ -0,0 +1,85 @@
+#ifndef __MEMORYPOOL_TRANSFERCACHE_H__
+#define __MEMORYPOOL_TRANSFERCACHE_H__
+
+#include "common.h"
+#include "remotefreequeue.h"
+#include "spinlock.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace MemoryPool_V2
+{
+// 传输缓存的统计（所有大小类之和）
+struct TransferCacheStats
+{
+    uint64_t insertHits = 0;   // 整批放入传输缓存的次数
+    uint64_t insertMisses = 0; // 整批归还但传输缓存已满，转交中心缓存的次数
+    uint64_t removeHits = 0;   // 整批从传输缓存取出的次数
+    uint64_t removeMisses = 0; // 整批获取但传输缓存为空，转向中心缓存的次数
+    size_t cachedBlocks = 0;   // 当前暂存的块数
+};
+
+// 传输缓存：位于线程缓存（及每 CPU 缓存）与中心缓存之间
+// 每个大小类暂存若干个整批（numMoveSize 个块）的块地址，一个线程归还的整批可以原样交给另一个线程，
+// 不必逐块放回 span 再重新取出；只有块数恰好为一批的搬运经过这里，其余直接转交中心缓存
+// 接口与 CentralCache 相同，调用方不需要区分两层；整批转手时清除所属 span 的归属（见 Span::owner）
+class TransferCache
+{
+  public:
+    // 每个大小类最多暂存的块数与字节数，放不下一批的大小类不使用传输缓存
+    static const size_t MAX_CACHED_BLOCKS = 1024;
+    static const size_t MAX_CACHED_BYTES = 256 * 1024;
+
+    static TransferCache *getInstance()
+    {
+        static TransferCache instance;
+        return &instance;
+    }
+
+    size_t fetchRange(void *&start, void *&end, size_t batchNum, size_t index, RemoteFreeQueue *owner = nullptr);
+    void *returnRange(void *start, size_t size, size_t index);
+    size_t fetchBatch(void **batch, size_t batchNum, size_t index, RemoteFreeQueue *owner = nullptr);
+    void returnBatch(void *const *batch, size_t num, size_t index);
+
+    // 把暂存的所有批次归还中心缓存
+    void flush();
+    TransferCacheStats getStats() const;
+    // 大小类 index 最多暂存的块数（一批的整数倍），0 表示不使用传输缓存
+    static size_t capacity(size_t index);
+
+  private:
+    // 每个大小类的暂存批次独占缓存行，slots 首次放入时分配
+    struct alignas(CACHE_LINE_SIZE) TransferList
+    {
+        SpinLock lock;
+        void **slots = nullptr;
+        size_t used = 0;
+        std::atomic<uint64_t> insertHits{0};
+        std::atomic<uint64_t> insertMisses{0};
+        std::atomic<uint64_t> removeHits{0};
+        std::atomic<uint64_t> removeMisses{0};
+    };
+
+    TransferCache() = default;
+    TransferCache(const TransferCache &) = delete;
+    TransferCache &operator=(const TransferCache &) = delete;
+
+    // 整批放入/取出，成功返回 true；调用方不持有锁
+    bool insertBatch(void *const *batch, size_t index);
+    bool removeBatch(void **batch, size_t index);
+    // 清除整批块所属 span 的归属，调用方不持有锁
+    static void clearOwners(void *const *batch, size_t num);
+    // 计数器只在持锁时修改
+    static void bump(std::atomic<uint64_t> &counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+  private:
+    std::array<TransferList, FREE_LIST_SIZE> m_lists;
+};
+} // namespace MemoryPool_V2
+
+#endif //__MEMORYPOOL_TRANSFERCACHE_H__
@@ -1,325 +1,395 @@
 #include "../include/centralcache.h"
 #include "../include/pagecache.h"
 
-// #include <iostream>
-#include <thread>
-#include <unordered_map>
+#include <mutex>
 
 namespace MemoryPool_V2
 {
-const std::chrono::milliseconds CentralCache::DELAY_INTERVAL{1000};
 
-static const size_t SPAN_PAGES = 8; // 每次从PageCache获取span大小（以页为单位）
+CentralCache::CentralCache() = default;
 
-CentralCache::CentralCache()
+size_t CentralCache::fetchRange(void *&start, void *&end, size_t batchNum, size_t index, RemoteFreeQueue *owner)
 {
-    init();
-}
+    start = nullptr;
+    end = nullptr;
+    // 大内存直接上操作系统申请
+    if (index >= FREE_LIST_SIZE || batchNum == 0)
+    {
+        return 0;
+    }
 
-void CentralCache::init()
-{
-    for (auto &ptr : m_centralFreeList)
+    CentralFreeList &list = m_lists[index];
+    std::lock_guard<SpinLock> guard(list.lock);
+    if (list.partialSpans == nullptr && !refillPartial(index))
+    {
+        // 没有可用的span，且从PageCache获取失败
+        return 0;
+    }
+
+    // 依次从有空闲块的span中取，取空的span移到 emptySpans
+    size_t actualNum = 0;
+    while (actualNum < batchNum && list.partialSpans != nullptr)
     {
-        ptr.store(nullptr, std::memory_order_relaxed);
+        Span *span = list.partialSpans;
+        bool dedicated = span->useCount == 0;
+        actualNum += fetchFromSpan(span, start, end, batchNum - actualNum);
+        updateOwner(span, owner, dedicated);
+        if (!hasFreeBlocks(span))
+        {
+            removeSpan(list.partialSpans, span);
+            pushSpan(list.emptySpans, span);
+        }
     }
-    for (auto &lock : m_locks)
+    return actualNum;
+}
+
+size_t CentralCache::fetchBatch(void **batch, size_t batchNum, size_t index, RemoteFreeQueue *owner)
+{
+    if (index >= FREE_LIST_SIZE || batchNum == 0)
     {
-        lock.clear();
+        return 0;
     }
-    for (auto &count : m_delayCounts)
+
+    CentralFreeList &list = m_lists[index];
+    std::lock_guard<SpinLock> guard(list.lock);
+    if (list.partialSpans == nullptr && !refillPartial(index))
     {
-        count.store(0, std::memory_order_relaxed);
+        return 0;
     }
-    for (auto &time : m_lastReturnTimes)
+
+    // 与 fetchRange 相同，只是块地址直接写入数组，不再串成链表
+    size_t actualNum = 0;
+    while (actualNum < batchNum && list.partialSpans != nullptr)
     {
-        time = std::chrono::steady_clock::now();
+        Span *span = list.partialSpans;
+        bool dedicated = span->useCount == 0;
+        actualNum += fetchFromSpan(span, batch + actualNum, batchNum - actualNum);
+        updateOwner(span, owner, dedicated);
+        if (!hasFreeBlocks(span))
+        {
+            removeSpan(list.partialSpans, span);
+            pushSpan(list.emptySpans, span);
+        }
     }
-    m_spanCount.store(0, std::memory_order_relaxed);
+    return actualNum;
 }
 
-void *CentralCache::fetchRange(size_t index)
+void *CentralCache::returnRange(void *start, size_t size, size_t index)
 {
-    // 大内存直接上操作系统申请
-    if (index >= FREE_LIST_SIZE)
+    if (start == nullptr || index >= FREE_LIST_SIZE)
     {
-        return nullptr;
+        return start;
+    }
+    size_t blockNum = size / SizeClass::classSize(index);
+
+    Span *released = nullptr;
+    void *current = start;
+    {
+        std::lock_guard<SpinLock> guard(m_lists[index].lock);
+        // 逐块归还到各自所属的span，无需扫描整个链表
+        for (size_t i = 0; i < blockNum && current != nullptr; i++)
+        {
+            void *next = *reinterpret_cast<void **>(current);
+            returnBlock(current, index, released);
+            current = next;
+        }
     }
+    releaseSpans(released);
+    return current;
+}
 
-    // 自旋锁
-    while (m_locks[index].test_and_set(std::memory_order_acquire))
+void CentralCache::returnBatch(void *const *batch, size_t num, size_t index)
+{
+    if (num == 0 || index >= FREE_LIST_SIZE)
     {
-        std::this_thread::yield();
+        return;
     }
 
-    void *res = nullptr;
-    try
+    Span *released = nullptr;
     {
-        res = m_centralFreeList[index].load(std::memory_order_relaxed);
-        if (res == nullptr)
+        std::lock_guard<SpinLock> guard(m_lists[index].lock);
+        for (size_t i = 0; i < num; i++)
         {
-            // 从PageCache中获取新的内存块
-            size_t size = (index + 1) * ALIGNMENT;
-            res = fetchFromPageCache(size);
+            returnBlock(batch[i], index, released);
+        }
+    }
+    releaseSpans(released);
+}
 
-            if (res == nullptr)
-            {
-                // 获取失败
-                m_locks[index].clear(std::memory_order_release);
-                return nullptr;
-            }
+LockStats CentralCache::lockStats(size_t index) const
+{
+    return index < FREE_LIST_SIZE ? m_lists[index].lock.stats() : LockStats();
+}
 
-            // 从 PageCache获取成功
-            char *start = static_cast<char *>(res);
-            size_t numPages = (size <= SPAN_PAGES * PageCache::PAGE_SIZE)
-                                  ? SPAN_PAGES
-                                  : (size + PageCache::PAGE_SIZE - 1) / PageCache::PAGE_SIZE;
-            size_t blockNum = (numPages * PageCache::PAGE_SIZE) / size;
-            if (blockNum > 1)
+size_t CentralCache::reclaimIdleSpans(uint64_t minAgeEpochs, size_t maxSpans)
+{
+    uint64_t epoch = m_epoch.load(std::memory_order_relaxed);
+    size_t reclaimed = 0;
+    // 从上次停下的大小类继续，每次调用至多交还 maxSpans 个 span
+    size_t cursor = m_reclaimCursor.load(std::memory_order_relaxed);
+    for (size_t n = 0; n < FREE_LIST_SIZE && reclaimed < maxSpans; n++)
+    {
+        size_t index = (cursor + n) % FREE_LIST_SIZE;
+        CentralFreeList &list = m_lists[index];
+        Span *released = nullptr;
+        {
+            std::lock_guard<SpinLock> guard(list.lock);
+            Span *span = list.idleSpans;
+            while (span != nullptr && reclaimed < maxSpans)
             {
-                // 构建链表
-                for (size_t i = 1; i < blockNum; i++)
+                Span *next = span->next;
+                if (epoch - span->freeEpoch >= minAgeEpochs)
                 {
-                    void *current = start + (i - 1) * size;
-                    void *next = start + i * size;
-                    *reinterpret_cast<void **>(current) = next;
+                    removeSpan(list.idleSpans, span);
+                    m_idlePages.fetch_sub(span->numPages, std::memory_order_relaxed);
+                    span->next = released;
+                    released = span;
+                    reclaimed++;
                 }
-                *reinterpret_cast<void **>(start + (blockNum - 1) * size) = nullptr;
-
-                // 获取对应内存 将res断开
-                void *next = *reinterpret_cast<void **>(res);
-                *reinterpret_cast<void **>(res) = nullptr;
-                m_centralFreeList[index].store(next, std::memory_order_release);
-            }
-            // 记录span信息，为将CentralCache 多余内存块归还PageCache做准备
-            // 1.CentralCache管理小块内存，这些内存可能不连续
-            // 2.PageCache 的 deallocateSpan 要求归还连续的内存
-            // 这里也需要原子操作 why? 因为 m_spanCount 是全局共享的
-            // ，而前面使用的自旋锁加锁是按index分段的，所以需要使用原子操作保证安全
-            size_t trackerIndex = m_spanCount.fetch_add(1, std::memory_order_relaxed);
-            if (trackerIndex < m_spanTrackers.size())
-            {
-                m_spanTrackers[trackerIndex].spanAddr.store(start, std::memory_order_release);
-                m_spanTrackers[trackerIndex].numPages.store(numPages, std::memory_order_release);
-                m_spanTrackers[trackerIndex].blockCount.store(blockNum, std::memory_order_release);
-                m_spanTrackers[trackerIndex].freeCount.store(blockNum - 1, std::memory_order_release);
+                span = next;
             }
         }
-        else
-        {
-            void *next = *reinterpret_cast<void **>(res);
-            *reinterpret_cast<void **>(res) = nullptr;
-            m_centralFreeList[index].store(next, std::memory_order_release);
+        releaseSpans(released);
+        m_reclaimCursor.store((index + 1) % FREE_LIST_SIZE, std::memory_order_relaxed);
+    }
+    return reclaimed;
+}
 
-            // 更新span 对应的freeCount减1
-            SpanTracker *tracker = getSpanTracker(res);
-            if (tracker != nullptr)
-            {
-                tracker->freeCount.fetch_sub(1, std::memory_order_release);
-            }
-            else
-            {
-                // std::cout << "[CentralCache::fetchRange]: getSpanTracker异常" << std::endl;
-                return nullptr;
-            }
+void CentralCache::updateOwner(Span *span, RemoteFreeQueue *owner, bool dedicated)
+{
+    // 领取前 span 的块全部在中心缓存，本次领取的线程独占该 span；
+    // 已有块在别的线程手中时 span 由多个线程共享，不再记录归属，直到块全部归还
+    if (dedicated)
+    {
+        span->owner.store(owner, std::memory_order_relaxed);
+    }
+    else if (span->owner.load(std::memory_order_relaxed) != owner)
+    {
+        span->owner.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+bool CentralCache::refillPartial(size_t index)
+{
+    CentralFreeList &list = m_lists[index];
+    Span *span = list.idleSpans;
+    if (span != nullptr)
+    {
+        // 优先复用刚空闲的 span，块都还在它的空闲链表上，不必再经过 PageCache
+        removeSpan(list.idleSpans, span);
+        m_idlePages.fetch_sub(span->numPages, std::memory_order_relaxed);
+    }
+    else
+    {
+        span = fetchFromPageCache(index);
+        if (span == nullptr)
+        {
+            return false;
         }
     }
-    catch (...)
+    pushSpan(list.partialSpans, span);
+    return true;
+}
+
+void CentralCache::releaseSpans(Span *spans)
+{
+    while (spans != nullptr)
     {
-        m_locks[index].clear(std::memory_order_release);
-        throw;
+        Span *next = spans->next;
+        spans->next = nullptr;
+        spans->freeList = nullptr;
+        PageCache::getInstance()->deallocateSpan(spans->pageAddr);
+        spans = next;
     }
-    m_locks[index].clear(std::memory_order_release);
-    return res;
 }
 
-void CentralCache::returnRange(void *start, size_t size, size_t index)
+void CentralCache::returnBlock(void *ptr, size_t index, Span *&released)
 {
-    if (start == nullptr || index >= FREE_LIST_SIZE)
+    Span *span = m_pageMap->get(ptr);
+    if (span == nullptr || span->objSize != SizeClass::classSize(index))
     {
+        // 不是本大小类的内存块，跳过
         return;
     }
-    size_t blockSize = (index + 1) * ALIGNMENT;
-    size_t blockNum = size / blockSize;
 
-    // 自旋锁
-    while (m_locks[index].test_and_set(std::memory_order_acquire))
+    if (!hasFreeBlocks(span))
     {
-        std::this_thread::yield(); // 当前线程主动让出CPU时间片
+        // span 重新有了空闲块
+        removeSpan(m_lists[index].emptySpans, span);
+        pushSpan(m_lists[index].partialSpans, span);
     }
+    *reinterpret_cast<void **>(ptr) = span->freeList;
+    span->freeList = ptr;
 
-    try
+    if (--span->useCount == 0)
     {
-        // 1. 将内存块串成链表
-        void *end = start;
-        size_t count = 1;
-        while (*reinterpret_cast<void **>(end) != nullptr && count < blockNum)
+        // 所有块都已归还：每个大小类留一个空闲 span 备用，先前留下的那个交给调用方在释放锁之后交还 PageCache，
+        // 不依赖回收线程也不会越积越多；空闲已久的备用 span 由回收线程按纪元交还。这里只做常数次链表操作，不读时钟
+        CentralFreeList &list = m_lists[index];
+        removeSpan(list.partialSpans, span);
+        span->owner.store(nullptr, std::memory_order_relaxed);
+        if (list.idleSpans != nullptr)
         {
-            end = *reinterpret_cast<void **>(end);
-            count++;
+            Span *older = list.idleSpans;
+            removeSpan(list.idleSpans, older);
+            m_idlePages.fetch_sub(older->numPages, std::memory_order_relaxed);
+            older->next = released;
+            released = older;
         }
-        // 2. 将链表连接到中心缓存
-        void *current = m_centralFreeList[index].load(std::memory_order_relaxed);
-        *reinterpret_cast<void **>(end) = current;
-        m_centralFreeList[index].store(start, std::memory_order_release);
-
-        // 3. 更新延迟计数
-        size_t currentCount = m_delayCounts[index].fetch_add(1, std::memory_order_relaxed) + 1;
-        auto currentTime = std::chrono::steady_clock::now();
-
-        // 4. 检查是否需要执行延迟归还
-        if (isDelayReturn(index, currentCount, currentTime))
+        // 先预留页数再检查上限，多个大小类并发归还时合计也不会超出
+        if (m_idlePages.fetch_add(span->numPages, std::memory_order_relaxed) + span->numPages <= MAX_IDLE_PAGES)
         {
-            performDelayReturn(index);
+            span->freeEpoch = m_epoch.load(std::memory_order_relaxed);
+            pushSpan(list.idleSpans, span);
+        }
+        else
+        {
+            m_idlePages.fetch_sub(span->numPages, std::memory_order_relaxed);
+            span->next = released;
+            released = span;
         }
     }
-    catch (...)
-    {
-        m_locks[index].clear(std::memory_order_release);
-        throw;
-    }
-    m_locks[index].clear(std::memory_order_release);
 }
 
-bool CentralCache::isDelayReturn(size_t index, size_t currentCount, std::chrono::steady_clock::time_point currentTime)
+size_t CentralCache::fetchFromSpan(Span *span, void *&start, void *&end, size_t batchNum)
 {
-    if (currentCount >= MAX_DELAY_COUNT)
+    size_t num = 0;
+    // 先取切出后又归还的块
+    void *head = span->freeList;
+    if (head != nullptr)
     {
-        return true;
-    }
-    auto lastTime = m_lastReturnTimes[index];
-    return (currentTime - lastTime) >= DELAY_INTERVAL;
-}
-
-void CentralCache::performDelayReturn(size_t index)
-{
-    m_delayCounts[index].store(0, std::memory_order_relaxed);
-    m_lastReturnTimes[index] = std::chrono::steady_clock::now();
+        void *tail = head;
+        num = 1;
+        while (num < batchNum && *reinterpret_cast<void **>(tail) != nullptr)
+        {
+            tail = *reinterpret_cast<void **>(tail);
+            num++;
+        }
+        span->freeList = *reinterpret_cast<void **>(tail);
+        *reinterpret_cast<void **>(tail) = nullptr;
 
-    // 统计每个span的空闲块数
-    std::unordered_map<SpanTracker *, size_t> spanFreeCounts;
-    void *currentBlock = m_centralFreeList[index].load(std::memory_order_relaxed);
-    while (currentBlock != nullptr)
-    {
-        SpanTracker *tracker = getSpanTracker(currentBlock);
-        if (tracker != nullptr)
+        // 接到已取出链表的尾部
+        if (start == nullptr)
         {
-            spanFreeCounts[tracker]++;
+            start = head;
         }
         else
         {
-            // std::cout << "[CentralCache::performDelayReturn]: getSpanTracker异常" << std::endl;
-            return;
+            *reinterpret_cast<void **>(end) = head;
         }
-        currentBlock = *reinterpret_cast<void **>(currentBlock);
+        end = tail;
     }
 
-    for (const auto &[tracker, newFreeBlocks] : spanFreeCounts)
+    // 不够时从未切分的部分按顺序切出，只有真正交出的块才写入链表指针
+    while (num < batchNum && span->carvedCount < span->blockCount)
     {
-        updateSpanFreeCount(tracker, newFreeBlocks, index);
+        void *block = static_cast<char *>(span->pageAddr) + span->carvedCount * span->objSize;
+        span->carvedCount++;
+        *reinterpret_cast<void **>(block) = nullptr;
+        if (!span->zeroed)
+        {
+            markBlockDirty(block, span->objSize);
+        }
+        if (start == nullptr)
+        {
+            start = block;
+        }
+        else
+        {
+            *reinterpret_cast<void **>(end) = block;
+        }
+        end = block;
+        num++;
     }
+    span->useCount += num;
+    return num;
 }
 
-void CentralCache::updateSpanFreeCount(SpanTracker *tracker, size_t newFreeBlocks, size_t index)
+size_t CentralCache::fetchFromSpan(Span *span, void **batch, size_t batchNum)
 {
-    // 这里的tracker是m_spanTrackers中的某个值
-    // 直接获取就好了，在前面是已经记录过了的 XXX 不对
-    // todo : 在thread归还到central时没有对应的更新m_spanTrackers里的freeCount, 更新费时也不方便更新
-    // todo : 逻辑还存在问题需要修复
-    // if (tracker->freeCount.load(std::memory_order_relaxed) == newFreeBlocks)
-    // {
-    //     std::cout << "[CentralCache::updateSpanFreeCount] : 直接获取就好了，在前面是已经记录过了的 OK" << std::endl;
-    // }
-    // else
-    // {
-    //     std::cout << "[CentralCache::updateSpanFreeCount] : 记录的值和获取的值不一致" << std::endl;
-    // }
-    tracker->freeCount.store(newFreeBlocks, std::memory_order_relaxed);
-
-    // 所有块都空闲，归还span
-    if (newFreeBlocks == tracker->blockCount.load(std::memory_order_relaxed))
+    size_t num = 0;
+    void *current = span->freeList;
+    while (num < batchNum && current != nullptr)
     {
-        // std::cout << "[CentralCache::updateSpanFreeCount] : 归还到PageCache" << std::endl;
-        void *spanAddr = tracker->spanAddr.load(std::memory_order_relaxed);
-        size_t numPages = tracker->numPages.load(std::memory_order_relaxed);
-
-        void *head = m_centralFreeList[index].load(std::memory_order_relaxed);
-        void *newHead = nullptr;
-        void *tail = nullptr;
-        void *current = head;
-
-        char *spanStart = reinterpret_cast<char *>(spanAddr);
-        char *spanEnd = spanStart + numPages * PageCache::PAGE_SIZE;
-
-        // 把 m_centralFreeList[index] 遍历一遍，剔除所有属于 span 的节点，
-        // 只保留不属于该 span 的节点，并把它们重连成一个新的链表
-        while (current != nullptr)
-        {
-            void *next = *reinterpret_cast<void **>(current);
-            char *cur = reinterpret_cast<char *>(current);
-
-            if (cur >= spanStart && cur < spanEnd)
-            {
-                // skip
-            }
-            else
-            {
-                // 对于不属于该span的 进行连接
-                if (!newHead)
-                {
-                    newHead = current;
-                    tail = current;
-                }
-                else
-                {
-                    *reinterpret_cast<void **>(tail) = current;
-                    tail = current;
-                }
-            }
-            current = next;
-        }
-
-        if (tail != nullptr)
+        batch[num++] = current;
+        current = *reinterpret_cast<void **>(current);
+    }
+    span->freeList = current;
+    // 数组形式不需要链表指针，切自已清零 span 的块完全不会被写入
+    char *spanStart = static_cast<char *>(span->pageAddr);
+    while (num < batchNum && span->carvedCount < span->blockCount)
+    {
+        void *block = spanStart + span->carvedCount * span->objSize;
+        span->carvedCount++;
+        if (!span->zeroed)
         {
-            *reinterpret_cast<void **>(tail) = nullptr;
+            markBlockDirty(block, span->objSize);
         }
-
-        m_centralFreeList[index].store(newHead, std::memory_order_relaxed);
-        PageCache::getInstance()->deallocateSpan(spanAddr, numPages);
+        batch[num++] = block;
     }
+    span->useCount += num;
+    return num;
 }
 
-void *CentralCache::fetchFromPageCache(size_t size)
+Span *CentralCache::fetchFromPageCache(size_t index)
 {
-    // 1. 计算需要的页数
-    size_t numPages = (size + PageCache::PAGE_SIZE - 1) / PageCache::PAGE_SIZE;
-
-    // 2. 根据大小决定分配策略
-    if (size <= SPAN_PAGES * PageCache::PAGE_SIZE)
+    // 1. 页数由大小类表预先算好，兼顾末尾浪费与每个 span 的块数
+    size_t size = SizeClass::classSize(index);
+    size_t numPages = SizeClass::spanPages(index);
+
+    // 2. 向PageCache申请，同时得知页内容是否全为 0
+    bool zeroed = false;
+    void *memory = PageCache::getInstance()->allocateSpan(numPages, &zeroed);
+    if (memory == nullptr)
     {
-        return PageCache::getInstance()->allocateSpan(SPAN_PAGES);
+        return nullptr;
     }
-    else
+    // span 元数据由 PageCache 创建并登记在页表中，这里只需补充切分信息
+    Span *span = m_pageMap->get(memory);
+    if (span == nullptr)
     {
-        return PageCache::getInstance()->allocateSpan(numPages);
+        return nullptr;
     }
+
+    // 3. 只记录切分信息，块在领取时才从 span 起始处按顺序切出（不预先串成链表，不触碰整个 span）
+    span->objSize = size;
+    span->blockCount = (numPages * PageCache::PAGE_SIZE) / size;
+    span->useCount = 0;
+    span->carvedCount = 0;
+    span->zeroed = zeroed;
+    span->freeList = nullptr;
+    span->owner.store(nullptr, std::memory_order_relaxed);
+    span->next = nullptr;
+    span->prev = nullptr;
+    return span;
 }
 
-SpanTracker *CentralCache::getSpanTracker(void *blockAddr)
+void CentralCache::pushSpan(Span *&list, Span *span)
 {
-    // 不能直接使用void* 进行比较，可能会出现UB
-    // todo: 这里时间复杂度是O(n),后续可考虑优化为O(1),在block头部增加相应信息
-    char *blk = reinterpret_cast<char *>(blockAddr);
-    // 找到blockAddr 所属的span
-    for (size_t i = 0; i < m_spanCount.load(std::memory_order_relaxed); i++)
+    span->prev = nullptr;
+    span->next = list;
+    if (list != nullptr)
     {
-        char *startAddr = reinterpret_cast<char *>(m_spanTrackers[i].spanAddr.load(std::memory_order_relaxed));
-        size_t numPages = m_spanTrackers[i].numPages.load(std::memory_order_relaxed);
-        char *endAddr = startAddr + numPages * PageCache::PAGE_SIZE;
-        if (blk >= startAddr && blk <= endAddr)
-        {
-            return &m_spanTrackers[i];
-        }
+        list->prev = span;
+    }
+    list = span;
+}
+
+void CentralCache::removeSpan(Span *&list, Span *span)
+{
+    if (span->prev != nullptr)
+    {
+        span->prev->next = span->next;
+    }
+    else
+    {
+        list = span->next;
+    }
+    if (span->next != nullptr)
+    {
+        span->next->prev = span->prev;
     }
-    return nullptr;
+    span->prev = nullptr;
+    span->next = nullptr;
 }
-} // namespace MemoryPool_V2
\ No newline at end of file
+} // namespace MemoryPool_V2
@@ -0,0 +1,263 @@
+#include "../include/cpucache.h"
+#include "../include/centralcache.h"
+#include "../include/objectpool.h"
+#include "../include/pagecache.h"
+#include "../include/pagemap.h"
+#include "../include/threadcache.h"
+#include "../include/transfercache.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(__linux__)
+#include <sched.h>
+#if __has_include(<sys/rseq.h>)
+#include <sys/rseq.h>
+#define MEMORYPOOL_HAVE_RSEQ 1
+#endif
+#endif
+
+namespace MemoryPool_V2
+{
+std::atomic<bool> &CpuCache::enabledFlag()
+{
+    // getenv 不分配内存，作为 malloc 替换库时也可以安全调用
+    static std::atomic<bool> enabled{[] {
+        const char *env = getenv("MEMORYPOOL_PERCPU");
+        return env != nullptr && env[0] == '1';
+    }()};
+    return enabled;
+}
+
+int CpuCache::currentCpu()
+{
+#if defined(MEMORYPOOL_HAVE_RSEQ)
+    // glibc 2.35 起为每个线程注册 rseq，内核在调度时更新 cpu_id，读取只需一次内存访问
+    if (__rseq_size > 0)
+    {
+        const struct rseq *area = reinterpret_cast<const struct rseq *>(
+            static_cast<const char *>(__builtin_thread_pointer()) + __rseq_offset);
+        int cpu = static_cast<int>(__atomic_load_n(&area->cpu_id, __ATOMIC_RELAXED));
+        if (cpu >= 0)
+        {
+            return cpu;
+        }
+    }
+#endif
+#if defined(__linux__)
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+CpuCache::CpuSlab *CpuCache::currentSlab()
+{
+    int cpu = currentCpu();
+    if (cpu < 0 || static_cast<size_t>(cpu) >= MAX_CPUS)
+    {
+        return nullptr;
+    }
+    CpuSlab *slab = m_slabs[cpu].load(std::memory_order_acquire);
+    if (slab != nullptr)
+    {
+        return slab;
+    }
+
+    std::lock_guard<std::mutex> guard(m_createMutex);
+    slab = m_slabs[cpu].load(std::memory_order_relaxed);
+    if (slab == nullptr)
+    {
+        void *memory = metadataAlloc(sizeof(CpuSlab));
+        if (memory == nullptr)
+        {
+            return nullptr;
+        }
+        slab = new (memory) CpuSlab;
+        m_slabs[cpu].store(slab, std::memory_order_release);
+    }
+    return slab;
+}
+
+void *CpuCache::allocate(size_t size)
+{
+    if (size == 0)
+    {
+        size = ALIGNMENT;
+    }
+    if (size > MAX_BYTES)
+    {
+        return ThreadCache::allocateLarge(size);
+    }
+    CpuSlab *slab = currentSlab();
+    if (slab == nullptr)
+    {
+        return ThreadCache::getInstance()->allocate(size);
+    }
+
+    size_t index = SizeClass::getIndex(size);
+    lock(slab);
+    void *ptr = slab->freeList[index];
+    if (ptr != nullptr)
+    {
+        slab->freeList[index] = *reinterpret_cast<void **>(ptr);
+        slab->freeListSize[index]--;
+        unlock(slab);
+        return ptr;
+    }
+
+    unlock(slab);
+
+    // 未命中时从传输缓存或中心缓存批量获取，一个返回，其余留在本 CPU 缓存
+    // 获取期间不持有 slab 锁，下层变慢（如向系统申请页）时不阻塞同一 CPU 上的其他线程
+    void *start = nullptr;
+    void *end = nullptr;
+    size_t batchNum = SizeClass::numMoveSize(SizeClass::classSize(index));
+    size_t actualNum = TransferCache::getInstance()->fetchRange(start, end, batchNum, index);
+    if (actualNum > 1)
+    {
+        // 期间 slab 可能已被其他线程放入块，接在现有链表前面
+        lock(slab);
+        *reinterpret_cast<void **>(end) = slab->freeList[index];
+        slab->freeList[index] = *reinterpret_cast<void **>(start);
+        slab->freeListSize[index] += static_cast<uint32_t>(actualNum - 1);
+        unlock(slab);
+    }
+    return actualNum == 0 ? nullptr : start;
+}
+
+void CpuCache::deallocate(void *ptr, size_t size)
+{
+    if (size > MAX_BYTES)
+    {
+        ThreadCache::deallocateLarge(ptr);
+        return;
+    }
+    CpuSlab *slab = currentSlab();
+    if (slab == nullptr)
+    {
+        ThreadCache::getInstance()->deallocate(ptr, size);
+        return;
+    }
+
+    size_t index = SizeClass::getIndex(size);
+    size_t batchNum = SizeClass::numMoveSize(SizeClass::classSize(index));
+    markBlockDirty(ptr, SizeClass::classSize(index));
+    lock(slab);
+    *reinterpret_cast<void **>(ptr) = slab->freeList[index];
+    slab->freeList[index] = ptr;
+    slab->freeListSize[index]++;
+    // 每个大小类最多缓存两批，超出时摘下一批，释放 slab 锁后再归还
+    void *overflow = nullptr;
+    if (slab->freeListSize[index] > 2 * batchNum)
+    {
+        overflow = detachBlocks(slab, index, batchNum);
+    }
+    unlock(slab);
+    releaseBlocks(overflow, index, batchNum);
+}
+
+void CpuCache::deallocate(void *ptr)
+{
+    Span *span = PageMap::getInstance()->get(ptr);
+    if (span == nullptr || !span->isUse)
+    {
+        // 不是内存池分配的内存
+        return;
+    }
+    if (span->objSize == 0)
+    {
+        ThreadCache::deallocateLarge(ptr);
+        return;
+    }
+    deallocate(ptr, span->objSize);
+}
+
+void *CpuCache::allocateAligned(size_t size, size_t alignment)
+{
+    if (alignment <= ALIGNMENT)
+    {
+        return allocate(size);
+    }
+    if (size == 0)
+    {
+        size = ALIGNMENT;
+    }
+    if (size <= MAX_BYTES && alignment <= PageCache::PAGE_SIZE)
+    {
+        size_t index = SizeClass::alignedIndex(size, alignment);
+        if (index < FREE_LIST_SIZE)
+        {
+            return allocate(SizeClass::classSize(index));
+        }
+    }
+    return ThreadCache::allocateLargeAligned(size, alignment);
+}
+
+void *CpuCache::allocateZeroed(size_t size)
+{
+    if (size > MAX_BYTES)
+    {
+        bool zeroed = false;
+        void *ptr = ThreadCache::allocateLarge(size, &zeroed);
+        if (ptr != nullptr && !zeroed)
+        {
+            memset(ptr, 0, size);
+        }
+        return ptr;
+    }
+    void *ptr = allocate(size);
+    if (ptr != nullptr)
+    {
+        zeroBlock(ptr, size);
+    }
+    return ptr;
+}
+
+void CpuCache::flush()
+{
+    for (auto &entry : m_slabs)
+    {
+        CpuSlab *slab = entry.load(std::memory_order_acquire);
+        if (slab == nullptr)
+        {
+            continue;
+        }
+        for (size_t index = 0; index < FREE_LIST_SIZE; index++)
+        {
+            lock(slab);
+            size_t count = slab->freeListSize[index];
+            void *list = detachBlocks(slab, index, count);
+            unlock(slab);
+            releaseBlocks(list, index, count);
+        }
+    }
+}
+
+void *CpuCache::detachBlocks(CpuSlab *slab, size_t index, size_t count)
+{
+    if (count == 0)
+    {
+        return nullptr;
+    }
+    void *head = slab->freeList[index];
+    void *tail = head;
+    for (size_t i = 1; i < count; i++)
+    {
+        tail = *reinterpret_cast<void **>(tail);
+    }
+    slab->freeList[index] = *reinterpret_cast<void **>(tail);
+    *reinterpret_cast<void **>(tail) = nullptr;
+    slab->freeListSize[index] -= static_cast<uint32_t>(count);
+    return head;
+}
+
+void CpuCache::releaseBlocks(void *list, size_t index, size_t count)
+{
+    if (list != nullptr)
+    {
+        TransferCache::getInstance()->returnRange(list, count * SizeClass::classSize(index), index);
+    }
+}
+} // namespace MemoryPool_V2
@@ -0,0 +1,348 @@
+// 用内存池接管 malloc/free/new/delete，编译为 libmemorypool_malloc.so
+// 使用方式：LD_PRELOAD=/path/to/libmemorypool_malloc.so ./your_program
+#include "../include/common.h"
+#include "../include/cpucache.h"
+#include "../include/threadcache.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+using namespace MemoryPool_V2;
+
+namespace
+{
+constexpr size_t PAGE_SIZE = size_t(1) << PAGE_SHIFT;
+
+inline bool isPowerOfTwo(size_t value)
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+// 前端选择：开启每 CPU 缓存时走 CpuCache，否则走线程缓存
+inline void *frontAllocate(size_t size)
+{
+    return CpuCache::isEnabled() ? CpuCache::getInstance()->allocate(size) : ThreadCache::getInstance()->allocate(size);
+}
+
+inline void *frontAllocateAligned(size_t size, size_t alignment)
+{
+    return CpuCache::isEnabled() ? CpuCache::getInstance()->allocateAligned(size, alignment)
+                                 : ThreadCache::getInstance()->allocateAligned(size, alignment);
+}
+
+inline void *frontAllocateZeroed(size_t size)
+{
+    return CpuCache::isEnabled() ? CpuCache::getInstance()->allocateZeroed(size)
+                                 : ThreadCache::getInstance()->allocateZeroed(size);
+}
+
+inline void frontDeallocate(void *ptr)
+{
+    if (CpuCache::isEnabled())
+    {
+        CpuCache::getInstance()->deallocate(ptr);
+    }
+    else
+    {
+        ThreadCache::getInstance()->deallocate(ptr);
+    }
+}
+
+inline void frontDeallocate(void *ptr, size_t size)
+{
+    if (CpuCache::isEnabled())
+    {
+        CpuCache::getInstance()->deallocate(ptr, size);
+    }
+    else
+    {
+        ThreadCache::getInstance()->deallocate(ptr, size);
+    }
+}
+
+inline void *poolMalloc(size_t size)
+{
+    void *ptr = frontAllocate(size);
+    if (ptr == nullptr)
+    {
+        errno = ENOMEM;
+    }
+    return ptr;
+}
+
+inline void *poolMemalign(size_t alignment, size_t size)
+{
+    void *ptr = frontAllocateAligned(size, alignment);
+    if (ptr == nullptr)
+    {
+        errno = ENOMEM;
+    }
+    return ptr;
+}
+
+inline void poolFree(void *ptr)
+{
+    if (ptr != nullptr)
+    {
+        frontDeallocate(ptr);
+    }
+}
+
+// operator new 语义：失败时调用 new_handler，没有 handler 则抛出 bad_alloc
+void *cppNew(size_t size, size_t alignment)
+{
+    for (;;)
+    {
+        void *ptr = frontAllocateAligned(size, alignment);
+        if (ptr != nullptr)
+        {
+            return ptr;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+void *cppNewNothrow(size_t size, size_t alignment) noexcept
+{
+    try
+    {
+        return cppNew(size, alignment);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+inline void cppDeleteSized(void *ptr, size_t size)
+{
+    if (ptr != nullptr)
+    {
+        frontDeallocate(ptr, size);
+    }
+}
+} // namespace
+
+extern "C"
+{
+void *malloc(size_t size) noexcept
+{
+    return poolMalloc(size);
+}
+
+void free(void *ptr) noexcept
+{
+    poolFree(ptr);
+}
+
+void *calloc(size_t num, size_t size) noexcept
+{
+    if (size != 0 && num > SIZE_MAX / size)
+    {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    void *ptr = frontAllocateZeroed(num * size);
+    if (ptr == nullptr)
+    {
+        errno = ENOMEM;
+    }
+    return ptr;
+}
+
+void *realloc(void *ptr, size_t size) noexcept
+{
+    if (ptr == nullptr)
+    {
+        return poolMalloc(size);
+    }
+    if (size == 0)
+    {
+        poolFree(ptr);
+        return nullptr;
+    }
+
+    // 不是内存池分配的内存，无从得知原大小，拒绝处理且保持原块不变
+    size_t oldSize = ThreadCache::usableSize(ptr);
+    if (oldSize == 0)
+    {
+        errno = EINVAL;
+        return nullptr;
+    }
+    // 原块足够大且缩小不超过一半时原地返回
+    if (size <= oldSize && size >= oldSize / 2)
+    {
+        return ptr;
+    }
+
+    void *newPtr = poolMalloc(size);
+    if (newPtr == nullptr)
+    {
+        return nullptr;
+    }
+    memcpy(newPtr, ptr, oldSize < size ? oldSize : size);
+    poolFree(ptr);
+    return newPtr;
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size) noexcept
+{
+    if (!isPowerOfTwo(alignment) || alignment % sizeof(void *) != 0)
+    {
+        return EINVAL;
+    }
+    void *ptr = frontAllocateAligned(size, alignment);
+    if (ptr == nullptr)
+    {
+        return ENOMEM;
+    }
+    *memptr = ptr;
+    return 0;
+}
+
+void *aligned_alloc(size_t alignment, size_t size) noexcept
+{
+    if (!isPowerOfTwo(alignment))
+    {
+        errno = EINVAL;
+        return nullptr;
+    }
+    return poolMemalign(alignment, size);
+}
+
+void *memalign(size_t alignment, size_t size) noexcept
+{
+    if (!isPowerOfTwo(alignment))
+    {
+        errno = EINVAL;
+        return nullptr;
+    }
+    return poolMemalign(alignment, size);
+}
+
+void *valloc(size_t size) noexcept
+{
+    return poolMemalign(PAGE_SIZE, size);
+}
+
+void *pvalloc(size_t size) noexcept
+{
+    size = (size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    return poolMemalign(PAGE_SIZE, size == 0 ? PAGE_SIZE : size);
+}
+
+size_t malloc_usable_size(void *ptr) noexcept
+{
+    return ptr == nullptr ? 0 : ThreadCache::usableSize(ptr);
+}
+} // extern "C"
+
+// 普通 new/delete
+void *operator new(size_t size)
+{
+    return cppNew(size, 0);
+}
+
+void *operator new[](size_t size)
+{
+    return cppNew(size, 0);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return cppNewNothrow(size, 0);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return cppNewNothrow(size, 0);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    poolFree(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    poolFree(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+    poolFree(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept
+{
+    poolFree(ptr);
+}
+
+// 带大小的 delete：大小与分配时一致，可以省去页表查询
+void operator delete(void *ptr, size_t size) noexcept
+{
+    cppDeleteSized(ptr, size);
+}
+
+void operator delete[](void *ptr, size_t size) noexcept
+{
+    cppDeleteSized(ptr, size);
+}
+
+// 对齐 new/delete（C++17），对齐分配可能落在更大的大小类，释放统一走页表查询
+void *operator new(size_t size, std::align_val_t alignment)
+{
+    return cppNew(size, static_cast<size_t>(alignment));
+}
+
+void *operator new[](size_t size, std::align_val_t alignment)
+{
+    return cppNew(size, static_cast<size_t>(alignment));
+}
+
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return cppNewNothrow(size, static_cast<size_t>(alignment));
+}
+
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return cppNewNothrow(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept
+{
+    poolFree(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t) noexcept
+{
+    poolFree(ptr);
+}
+
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept
+{
+    poolFree(ptr);
+}
+
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept
+{
+    poolFree(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    poolFree(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    poolFree(ptr);
+}
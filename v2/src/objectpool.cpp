@@ -0,0 +1,39 @@
+#include "../include/objectpool.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#include <atomic>
+
+namespace MemoryPool_V2
+{
+namespace
+{
+std::atomic<size_t> g_metadataBytes{0};
+} // namespace
+
+void *metadataAlloc(size_t bytes)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    void *ptr = VirtualAlloc(nullptr, bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+    void *ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED)
+    {
+        ptr = nullptr;
+    }
+#endif
+    if (ptr != nullptr)
+    {
+        g_metadataBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    return ptr;
+}
+
+size_t metadataAllocatedBytes()
+{
+    return g_metadataBytes.load(std::memory_order_relaxed);
+}
+} // namespace MemoryPool_V2
@@ -1,179 +1,88 @@
 #include "../include/pagecache.h"
 
-#if defined(_WIN32) || defined(_WIN64)
-#include <windows.h>
-#else
-#include <sys/mman.h>
-#endif
-#include <cstring>
+#include <cstdlib>
 
 namespace MemoryPool_V2
 {
-void *PageCache::allocateSpan(size_t numPages)
+PageCache::PageCache()
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-
-    // 使用有序容器特有的查找接口
-    // auto it1 = m.lower_bound(2); // 第一个 >= 2 的迭代器
-    // auto it2 = m.upper_bound(2); // 第一个 > 2 的迭代器
-    auto it = m_freeSpans.lower_bound(numPages);
-    if (it != m_freeSpans.end())
-    {
-        Span *span = it->second;
-        Span *next = span->next;
-
-        if (span->next != nullptr)
-        {
-            it->second = next;
-        }
-        else
-        {
-            m_freeSpans.erase(it);
-        }
-
-        // span太大就分割
-        if (span->numPages > numPages)
-        {
-            char *temp = reinterpret_cast<char *>(span->pageAddr) + numPages * PAGE_SIZE;
-            Span *newSpan = new Span{reinterpret_cast<void *>(temp), span->numPages - numPages, nullptr};
-
-            // 放入对应列表头部
-            auto &list = m_freeSpans[newSpan->numPages];
-            newSpan->next = list;
-            list = newSpan;
-
-            span->numPages = numPages;
-            // 分割的同样需要记录信息
-            m_spanMap[newSpan->pageAddr] = newSpan;
-        }
-        // 记录信息
-        m_spanMap[span->pageAddr] = span;
-        return span->pageAddr;
-    }
-
-    // 向系统申请
-    void *memory = systemAlloc(numPages);
-    if (memory == nullptr)
+    // getenv 不分配内存，作为 malloc 替换库时也可以安全调用
+    const char *env = getenv("MEMORYPOOL_HUGEPAGES");
+    bool hugePageMode = env != nullptr && env[0] == '1';
+    for (size_t i = 0; i < NUM_HEAPS; i++)
     {
-        // todo : 分配失败，检查是否有对应的异常处理
-        return nullptr;
+        m_heaps[i].init(static_cast<uint8_t>(i), &m_epoch, &m_cachedPages, hugePageMode);
     }
+}
 
-    Span *span = new Span{memory, numPages, nullptr};
-
-    m_spanMap[memory] = span;
-    return memory;
+size_t PageCache::homeHeap()
+{
+    static std::atomic<size_t> nextHeap{0};
+    static thread_local size_t heap = nextHeap.fetch_add(1, std::memory_order_relaxed) % NUM_HEAPS;
+    return heap;
 }
 
-void PageCache::deallocateSpan(void *ptr, size_t numPages)
+void *PageCache::allocateSpan(size_t numPages, bool *zeroed)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    auto it = m_spanMap.find(ptr);
-    if (it == m_spanMap.end())
+    size_t home = homeHeap();
+    void *ptr = m_heaps[home].allocateSpan(numPages, zeroed, false, true);
+    if (ptr != nullptr)
     {
-        // 不是pagecache分配的内存
-        return;
+        return ptr;
     }
-    Span *span = it->second;
-    // 尝试合并相邻span
-    void *nextAddr = static_cast<void *>(static_cast<char *>(ptr) + numPages * PAGE_SIZE);
-    auto nextIt = m_spanMap.find(nextAddr);
-    if (nextIt != m_spanMap.end())
+    // 借用其他分片的空闲页，锁被占用就跳过，避免在慢路径上排队
+    for (size_t i = 1; i < NUM_HEAPS; i++)
     {
-        Span *nextSpan = nextIt->second;
-
-        // 判断是否在空闲链表中
-        bool flag = false;
-        size_t nextSpanSize = nextSpan->numPages;
-        auto &nextList = m_freeSpans[nextSpanSize];
-
-        if (nextList == nextSpan)
-        {
-            nextList = nextSpan->next;
-            flag = true;
-            // 如果移除后链表为空，从m_freeSpans中删除该键
-            if (nextList == nullptr)
-            {
-                m_freeSpans.erase(nextSpanSize);
-            }
-        }
-        else if (nextList != nullptr)
-        {
-            Span *prev = nextList;
-            while (prev->next != nullptr)
-            {
-                if (prev->next == nextSpan)
-                {
-                    // remove
-                    prev->next = nextSpan->next;
-                    flag = true;
-                    break;
-                }
-                prev = prev->next;
-            }
-            // 检查移除后链表是否为空，如果为空则删除该键
-            if (flag && nextList == nullptr)
-            {
-                m_freeSpans.erase(nextSpanSize);
-            }
-        }
-
-        // 合并
-        if (flag)
+        ptr = m_heaps[(home + i) % NUM_HEAPS].allocateSpan(numPages, zeroed, false, false);
+        if (ptr != nullptr)
         {
-            span->numPages += nextSpan->numPages;
-            m_spanMap.erase(nextAddr);
-            delete nextSpan;
+            return ptr;
         }
     }
-    auto itSpan = m_freeSpans.find(span->numPages);
-    if (itSpan != m_freeSpans.end())
-    {
-        // 已存在链表
-        span->next = itSpan->second;
-        itSpan->second = span;
-    }
-    else
+    return m_heaps[home].allocateSpan(numPages, zeroed, true, true);
+}
+
+void PageCache::deallocateSpan(void *ptr)
+{
+    Span *span = PageMap::getInstance()->get(ptr);
+    size_t heapIndex = span != nullptr ? span->heapIndex.load(std::memory_order_relaxed) : Span::NO_HEAP;
+    if (heapIndex >= NUM_HEAPS)
     {
-        // 新建链表头
-        m_freeSpans[span->numPages] = span;
-        span->next = nullptr;
+        // 不是pagecache分配的内存
+        return;
     }
+    m_heaps[heapIndex].deallocateSpan(ptr);
 }
 
-void *PageCache::systemAlloc(size_t numPages)
+size_t PageCache::releaseIdlePages(uint64_t dirtyDecay, uint64_t muzzyDecay, size_t maxPages)
 {
-    size_t size = numPages * PAGE_SIZE;
-#if defined(_WIN32) || defined(_WIN64)
-    HANDLE hMap = CreateFileMapping(INVALID_HANDLE_VALUE,                  // 匿名映射
-                                    nullptr,                               // 默认安全属性
-                                    PAGE_READWRITE,                        // 可读写
-                                    static_cast<DWORD>(size >> 32),        // 高 32 位
-                                    static_cast<DWORD>(size & 0xFFFFFFFF), // 低 32 位
-                                    nullptr);
-    if (!hMap)
+    size_t releasedNum = 0;
+    for (PageHeap &heap : m_heaps)
     {
-        return nullptr;
+        if (releasedNum >= maxPages)
+        {
+            break;
+        }
+        releasedNum += heap.releaseIdlePages(dirtyDecay, muzzyDecay, maxPages - releasedNum);
     }
+    return releasedNum;
+}
 
-    void *ptr = MapViewOfFile(hMap, FILE_MAP_ALL_ACCESS, 0, 0, size);
-    CloseHandle(hMap); // 关闭句柄，不影响映射
-    if (!ptr)
+PageCacheStats PageCache::getStats()
+{
+    PageCacheStats stats;
+    for (PageHeap &heap : m_heaps)
     {
-        return nullptr;
+        heap.addStats(stats);
     }
+    return stats;
+}
 
-    memset(ptr, 0, size); // 初始化为 0
-    return ptr;
-#else
-    void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-    if (ptr == MAP_FAILED)
+void PageCache::setHugePageMode(bool enable)
+{
+    for (PageHeap &heap : m_heaps)
     {
-        return nullptr;
+        heap.setHugePageMode(enable);
     }
-    // 置0
-    memset(ptr, 0, size);
-    return ptr;
-#endif
 }
-} // namespace MemoryPool_V2
\ No newline at end of file
+} // namespace MemoryPool_V2
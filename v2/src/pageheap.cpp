@@ -0,0 +1,665 @@
+#include "../include/pageheap.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <intrin.h>
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#include <algorithm>
+
+namespace MemoryPool_V2
+{
+namespace
+{
+// bits 非 0
+inline size_t countTrailingZeros(uint64_t bits)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return index;
+#else
+    return static_cast<size_t>(__builtin_ctzll(bits));
+#endif
+}
+
+inline size_t floorLog2(size_t value)
+{
+    size_t log = 0;
+    while (value >>= 1)
+    {
+        log++;
+    }
+    return log;
+}
+} // namespace
+
+void PageHeap::init(uint8_t index, const std::atomic<uint64_t> *epoch, std::atomic<size_t> *totalCachedPages,
+                    bool hugePageMode)
+{
+    m_index = index;
+    m_epoch = epoch;
+    m_totalCachedPages = totalCachedPages;
+    m_hugePageMode = hugePageMode;
+}
+
+void PageHeap::setHugePageMode(bool enable)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_hugePageMode = enable;
+}
+
+Span *PageHeap::newSpan()
+{
+    // 对象池会重新构造 span（heapIndex 回到 NO_HEAP），每次都要重新标记所属页堆
+    Span *span = m_spanPool.newObject();
+    if (span != nullptr)
+    {
+        span->heapIndex.store(m_index, std::memory_order_relaxed);
+    }
+    return span;
+}
+
+void *PageHeap::allocateSpan(size_t numPages, bool *zeroed, bool allowSystem, bool wait)
+{
+    std::unique_lock<std::mutex> lock(m_mutex, std::defer_lock);
+    if (wait)
+    {
+        lock.lock();
+    }
+    else if (!lock.try_lock())
+    {
+        return nullptr;
+    }
+    return allocateLocked(numPages, zeroed, allowSystem);
+}
+
+void *PageHeap::allocateLocked(size_t numPages, bool *zeroed, bool allowSystem)
+{
+    // 从其他分片借用时每个分片都会探查一次缓存，只在最终由页堆分配成功时记一次未命中
+    bool largeMiss = numPages > MAX_PAGES && numPages <= LARGE_CACHE_MAX_PAGES;
+    if (largeMiss)
+    {
+        // 同一档位的 span 页数相同，缓存命中时整块复用
+        numPages = largeCachePages(numPages);
+        size_t index = largeCacheIndex(numPages);
+        Span *cached = m_largeCache[index];
+        if (cached != nullptr)
+        {
+            m_largeCache[index] = cached->next;
+            if (cached->next != nullptr)
+            {
+                cached->next->prev = nullptr;
+            }
+            cached->next = cached->prev = nullptr;
+            cached->isCached = false;
+            cached->isUse = true;
+            m_largeCacheCount[index]--;
+            m_cachedPages -= cached->numPages;
+            m_totalCachedPages->fetch_sub(cached->numPages, std::memory_order_relaxed);
+            m_largeCacheHits++;
+            // 缓存中的 span 所有页仍登记在页表中，无需更新
+            if (zeroed != nullptr)
+            {
+                *zeroed = cached->state == PageState::Clean;
+            }
+            return cached->pageAddr;
+        }
+    }
+
+    Span *span = popFreeSpan(numPages);
+    if (span != nullptr)
+    {
+        // span太大就分割
+        if (span->numPages > numPages)
+        {
+            char *temp = reinterpret_cast<char *>(span->pageAddr) + numPages * PAGE_SIZE;
+            Span *rest = newSpan();
+            if (rest == nullptr)
+            {
+                // 元数据分配失败，放回原链表
+                pushFreeSpan(span);
+                return nullptr;
+            }
+            rest->pageAddr = temp;
+            rest->numPages = span->numPages - numPages;
+            rest->state = span->state;
+            rest->freeEpoch = span->freeEpoch;
+            span->numPages = numPages;
+
+            // 分割出的空闲span放入对应链表，只需记录首尾页，供合并时查找
+            pushFreeSpan(rest);
+        }
+        // 记录信息：使用中的span登记所有页，任意块地址都能O(1)找到所属span
+        span->isUse = true;
+        span->objSize = 0;
+        m_pageMap->setRange(PageMap::pageIdOf(span->pageAddr), numPages, span);
+        if (zeroed != nullptr)
+        {
+            *zeroed = span->state == PageState::Clean;
+        }
+        if (largeMiss)
+        {
+            m_largeCacheMisses++;
+        }
+        return span->pageAddr;
+    }
+
+    if (!allowSystem)
+    {
+        return nullptr;
+    }
+
+    // 向系统申请，先准备好span元数据，避免申请到内存后无法登记
+    span = newSpan();
+    if (span == nullptr)
+    {
+        return nullptr;
+    }
+    void *memory = m_hugePageMode ? regionAlloc(numPages) : nullptr;
+    bool fromRegion = memory != nullptr;
+    if (memory == nullptr)
+    {
+        memory = systemAlloc(numPages);
+    }
+    if (memory == nullptr)
+    {
+        // 系统内存不足，由上层按分配失败处理（返回 nullptr 或抛出 std::bad_alloc）
+        m_spanPool.deleteObject(span);
+        return nullptr;
+    }
+    if (!m_pageMap->ensure(PageMap::pageIdOf(memory), numPages))
+    {
+        // 超出页表覆盖的地址范围或页表节点分配失败：退还刚申请的内存，
+        // 区域中的内存是最后切出的一块，持锁期间直接退回游标即可
+        if (fromRegion)
+        {
+            m_regionCursor = static_cast<char *>(memory);
+        }
+        else
+        {
+            systemFree(memory, numPages);
+        }
+        m_spanPool.deleteObject(span);
+        return nullptr;
+    }
+
+    span->pageAddr = memory;
+    span->numPages = numPages;
+    span->isUse = true;
+
+    m_pageMap->setRange(PageMap::pageIdOf(memory), numPages, span);
+    if (zeroed != nullptr)
+    {
+        *zeroed = true;
+    }
+    if (largeMiss)
+    {
+        m_largeCacheMisses++;
+    }
+    return memory;
+}
+
+void PageHeap::deallocateSpan(void *ptr)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Span *span = m_pageMap->get(ptr);
+    if (span == nullptr || span->heapIndex.load(std::memory_order_relaxed) != m_index || span->pageAddr != ptr ||
+        !span->isUse)
+    {
+        // 不是pagecache分配的内存
+        return;
+    }
+    span->isUse = false;
+    span->objSize = 0;
+    span->state = PageState::Dirty;
+    span->freeEpoch = m_epoch->load(std::memory_order_relaxed);
+    if (span->numPages > MAX_PAGES && span->numPages <= LARGE_CACHE_MAX_PAGES)
+    {
+        pushCachedSpan(span);
+        return;
+    }
+    pushFreeSpan(coalesce(span));
+}
+
+size_t PageHeap::largeCacheIndex(size_t numPages)
+{
+    // numPages 已按档位取整：[2^k, 2^(k+1)) 内步长为 2^(k-3)，从 k = 7 开始编号
+    size_t log = floorLog2(numPages);
+    return (log - 7) * 8 + (numPages >> (log - 3)) - 8;
+}
+
+size_t PageHeap::largeCachePages(size_t numPages)
+{
+    size_t step = size_t(1) << (floorLog2(numPages) - 3);
+    return (numPages + step - 1) & ~(step - 1);
+}
+
+void PageHeap::pushCachedSpan(Span *span)
+{
+    size_t index = largeCacheIndex(span->numPages);
+    span->isCached = true;
+    span->prev = nullptr;
+    span->next = m_largeCache[index];
+    if (span->next != nullptr)
+    {
+        span->next->prev = span;
+    }
+    m_largeCache[index] = span;
+    m_largeCacheCount[index]++;
+    m_cachedPages += span->numPages;
+    m_totalCachedPages->fetch_add(span->numPages, std::memory_order_relaxed);
+
+    // 超过每档深度时淘汰该档最早放入的 span
+    if (m_largeCacheCount[index] > LARGE_CACHE_DEPTH)
+    {
+        Span *oldest = span;
+        while (oldest->next != nullptr)
+        {
+            oldest = oldest->next;
+        }
+        evictCachedSpan(oldest);
+    }
+    // 所有分片合计超过总量上限时从本分片最大的档位开始淘汰，尽量保留刚放入的 span；
+    // 本分片的其他 span 都淘汰后仍超出，刚放入的 span 也不缓存
+    for (size_t i = LARGE_CACHE_BUCKETS; i > 0 && overCacheLimit(); i--)
+    {
+        Span *victim = m_largeCache[i - 1];
+        while (victim != nullptr && overCacheLimit())
+        {
+            Span *next = victim->next;
+            if (victim != span)
+            {
+                evictCachedSpan(victim);
+            }
+            victim = next;
+        }
+    }
+    if (overCacheLimit())
+    {
+        evictCachedSpan(span);
+    }
+}
+
+void PageHeap::evictCachedSpan(Span *span)
+{
+    size_t index = largeCacheIndex(span->numPages);
+    if (span->prev != nullptr)
+    {
+        span->prev->next = span->next;
+    }
+    else
+    {
+        m_largeCache[index] = span->next;
+    }
+    if (span->next != nullptr)
+    {
+        span->next->prev = span->prev;
+    }
+    span->prev = span->next = nullptr;
+    span->isCached = false;
+    m_largeCacheCount[index]--;
+    m_cachedPages -= span->numPages;
+    m_totalCachedPages->fetch_sub(span->numPages, std::memory_order_relaxed);
+    pushFreeSpan(coalesce(span));
+}
+
+Span *PageHeap::coalesce(Span *span)
+{
+    // 空闲span的首尾页总是登记正确，使用中的span所有页都登记，
+    // 因此相邻页查到的span只要地址首尾相接且空闲，就是可以合并的邻居；
+    // 合并后内部页可能残留指向已回收元数据的旧映射，比对地址即可排除；
+    // 旧映射也可能指向其他页堆正在回收或重新构造的 span，它的 heapIndex 只会是那个页堆的编号或 NO_HEAP，
+    // 因此先原子地比对 heapIndex，相等说明 span 由本页堆的对象池管理、受本页堆的锁保护，再读取其他字段
+    char *begin = static_cast<char *>(span->pageAddr);
+    Span *prevSpan = m_pageMap->get(static_cast<void *>(begin - PAGE_SIZE));
+    if (prevSpan != nullptr && prevSpan->heapIndex.load(std::memory_order_relaxed) == m_index && !prevSpan->isUse &&
+        !prevSpan->isCached &&
+        static_cast<char *>(prevSpan->pageAddr) + prevSpan->numPages * PAGE_SIZE == begin)
+    {
+        removeFreeSpan(prevSpan);
+        // 合并后的状态取较脏者，纪元取较新者
+        prevSpan->numPages += span->numPages;
+        prevSpan->state = std::max(prevSpan->state, span->state);
+        prevSpan->freeEpoch = std::max(prevSpan->freeEpoch, span->freeEpoch);
+        m_spanPool.deleteObject(span);
+        span = prevSpan;
+    }
+
+    void *nextAddr = static_cast<void *>(static_cast<char *>(span->pageAddr) + span->numPages * PAGE_SIZE);
+    Span *nextSpan = m_pageMap->get(nextAddr);
+    if (nextSpan != nullptr && nextSpan->heapIndex.load(std::memory_order_relaxed) == m_index && !nextSpan->isUse &&
+        !nextSpan->isCached && nextSpan->pageAddr == nextAddr)
+    {
+        removeFreeSpan(nextSpan);
+        span->numPages += nextSpan->numPages;
+        span->state = std::max(span->state, nextSpan->state);
+        span->freeEpoch = std::max(span->freeEpoch, nextSpan->freeEpoch);
+        m_spanPool.deleteObject(nextSpan);
+    }
+    return span;
+}
+
+size_t PageHeap::releaseIdlePages(uint64_t dirtyDecay, uint64_t muzzyDecay, size_t maxPages)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t epoch = m_epoch->load(std::memory_order_relaxed);
+    size_t releasedNum = 0;
+
+    // 缓存中空闲已久的大 span 不太可能再被复用，放回页堆合并后一并归还
+    for (Span *list : m_largeCache)
+    {
+        Span *span = list;
+        while (span != nullptr)
+        {
+            Span *next = span->next;
+            if (epoch - span->freeEpoch >= dirtyDecay)
+            {
+                evictCachedSpan(span);
+            }
+            span = next;
+        }
+    }
+
+    auto releaseList = [&](Span *list) {
+        for (Span *span = list; span != nullptr && releasedNum < maxPages; span = span->next)
+        {
+            uint64_t idle = epoch - span->freeEpoch;
+            bool released = false;
+            if (span->state == PageState::Dirty && idle >= dirtyDecay)
+            {
+                // MADV_FREE 不可用时退化为直接 MADV_DONTNEED
+                released = (muzzyDecay > 0 && systemRelease(span, PageState::Muzzy)) ||
+                           systemRelease(span, PageState::Clean);
+            }
+            else if (span->state == PageState::Muzzy && idle >= muzzyDecay)
+            {
+                released = systemRelease(span, PageState::Clean);
+            }
+            if (released)
+            {
+                span->freeEpoch = epoch;
+                releasedNum += span->numPages;
+            }
+        }
+    };
+
+    releaseList(m_largeSpans);
+    for (size_t n = MAX_PAGES; n > 0 && releasedNum < maxPages; n--)
+    {
+        releaseList(m_freeSpans[n]);
+    }
+    return releasedNum;
+}
+
+void PageHeap::addStats(PageCacheStats &stats)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto countList = [&stats](Span *list) {
+        for (Span *span = list; span != nullptr; span = span->next)
+        {
+            stats.freePages += span->numPages;
+            switch (span->state)
+            {
+            case PageState::Dirty:
+                stats.dirtyPages += span->numPages;
+                break;
+            case PageState::Muzzy:
+                stats.muzzyPages += span->numPages;
+                break;
+            case PageState::Clean:
+                stats.cleanPages += span->numPages;
+                break;
+            }
+        }
+    };
+    countList(m_largeSpans);
+    for (Span *list : m_freeSpans)
+    {
+        countList(list);
+    }
+    stats.releasedPages += m_releasedPages;
+    stats.cachedPages += m_cachedPages;
+    stats.largeCacheHits += m_largeCacheHits;
+    stats.largeCacheMisses += m_largeCacheMisses;
+    stats.hugePageRegions += m_hugePageRegions;
+}
+
+bool PageHeap::systemRelease(Span *span, PageState newState)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    (void)span;
+    (void)newState;
+    return false;
+#else
+    size_t size = span->numPages * PAGE_SIZE;
+    int advice = MADV_DONTNEED;
+    if (newState == PageState::Muzzy)
+    {
+#ifdef MADV_FREE
+        advice = MADV_FREE;
+#else
+        return false;
+#endif
+    }
+    if (madvise(span->pageAddr, size, advice) != 0)
+    {
+        return false;
+    }
+    span->state = newState;
+    if (newState == PageState::Clean)
+    {
+        m_releasedPages += span->numPages;
+    }
+    return true;
+#endif
+}
+
+void PageHeap::pushFreeSpan(Span *span)
+{
+    // 空闲span更新首尾页映射
+    size_t pageId = PageMap::pageIdOf(span->pageAddr);
+    m_pageMap->set(pageId, span);
+    m_pageMap->set(pageId + span->numPages - 1, span);
+
+    Span *&list = freeList(span->numPages);
+    span->prev = nullptr;
+    span->next = list;
+    if (list != nullptr)
+    {
+        list->prev = span;
+    }
+    list = span;
+    if (span->numPages <= MAX_PAGES)
+    {
+        m_nonEmpty[span->numPages / 64] |= uint64_t(1) << (span->numPages % 64);
+    }
+}
+
+void PageHeap::removeFreeSpan(Span *span)
+{
+    Span *&list = freeList(span->numPages);
+    if (span->prev != nullptr)
+    {
+        span->prev->next = span->next;
+    }
+    else
+    {
+        list = span->next;
+    }
+    if (span->next != nullptr)
+    {
+        span->next->prev = span->prev;
+    }
+    span->prev = span->next = nullptr;
+    if (list == nullptr && span->numPages <= MAX_PAGES)
+    {
+        m_nonEmpty[span->numPages / 64] &= ~(uint64_t(1) << (span->numPages % 64));
+    }
+}
+
+Span *PageHeap::popFreeSpan(size_t numPages)
+{
+    // 在位图中找第一个页数 >= numPages 的非空桶
+    for (size_t word = numPages / 64; numPages <= MAX_PAGES && word < BITMAP_WORDS; word++)
+    {
+        uint64_t bits = m_nonEmpty[word];
+        if (word == numPages / 64)
+        {
+            bits &= ~uint64_t(0) << (numPages % 64);
+        }
+        if (bits != 0)
+        {
+            Span *span = m_freeSpans[word * 64 + countTrailingZeros(bits)];
+            removeFreeSpan(span);
+            return span;
+        }
+    }
+    // 再在大span链表中找最合适的
+    Span *best = nullptr;
+    for (Span *span = m_largeSpans; span != nullptr; span = span->next)
+    {
+        if (span->numPages >= numPages && (best == nullptr || span->numPages < best->numPages))
+        {
+            best = span;
+        }
+    }
+    if (best != nullptr)
+    {
+        removeFreeSpan(best);
+    }
+    return best;
+}
+
+void *PageHeap::systemAlloc(size_t numPages)
+{
+    size_t size = numPages * PAGE_SIZE;
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE hMap = CreateFileMapping(INVALID_HANDLE_VALUE,                  // 匿名映射
+                                    nullptr,                               // 默认安全属性
+                                    PAGE_READWRITE,                        // 可读写
+                                    static_cast<DWORD>(size >> 32),        // 高 32 位
+                                    static_cast<DWORD>(size & 0xFFFFFFFF), // 低 32 位
+                                    nullptr);
+    if (!hMap)
+    {
+        return nullptr;
+    }
+
+    void *ptr = MapViewOfFile(hMap, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    CloseHandle(hMap); // 关闭句柄，不影响映射
+    // 匿名映射的页由系统清零，且在首次访问时才分配物理内存，这里不再 memset
+    return ptr;
+#else
+    void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    // 匿名映射的页由内核清零，且在首次访问时才分配物理内存，这里不再 memset
+    return ptr == MAP_FAILED ? nullptr : ptr;
+#endif
+}
+
+void PageHeap::systemFree(void *ptr, size_t numPages)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    (void)numPages;
+    UnmapViewOfFile(ptr);
+#else
+    munmap(ptr, numPages * PAGE_SIZE);
+#endif
+}
+
+void *PageHeap::regionAlloc(size_t numPages)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    (void)numPages;
+    return nullptr;
+#else
+    size_t size = numPages * PAGE_SIZE;
+    if (size > REGION_SIZE / 2)
+    {
+        // 特别大的请求单独映射，避免浪费区域剩余空间
+        return nullptr;
+    }
+    if (m_regionCursor == nullptr || size > static_cast<size_t>(m_regionEnd - m_regionCursor))
+    {
+        retireRegion();
+        if (!reserveRegion())
+        {
+            return nullptr;
+        }
+    }
+
+    char *ptr = m_regionCursor;
+    m_regionCursor += size;
+    // 只对已切出的部分申请大页，未使用的区域不会因大页而提前占用物理内存
+    char *advisedEnd = reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(m_regionCursor) + HUGE_PAGE_SIZE - 1) &
+                                                ~(HUGE_PAGE_SIZE - 1));
+    if (advisedEnd > m_hugeAdvised)
+    {
+#ifdef MADV_HUGEPAGE
+        madvise(m_hugeAdvised, advisedEnd - m_hugeAdvised, MADV_HUGEPAGE);
+#endif
+        m_hugeAdvised = advisedEnd;
+    }
+    return ptr;
+#endif
+}
+
+bool PageHeap::reserveRegion()
+{
+#if defined(_WIN32) || defined(_WIN64)
+    return false;
+#else
+    // 多映射一个大页的长度，截掉首尾得到 2MB 对齐的区域
+    size_t mapSize = REGION_SIZE + HUGE_PAGE_SIZE;
+    void *raw = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (raw == MAP_FAILED)
+    {
+        return false;
+    }
+    uintptr_t rawAddr = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t start = (rawAddr + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    size_t head = start - rawAddr;
+    size_t tail = mapSize - head - REGION_SIZE;
+    if (head > 0)
+    {
+        munmap(raw, head);
+    }
+    if (tail > 0)
+    {
+        munmap(reinterpret_cast<void *>(start + REGION_SIZE), tail);
+    }
+
+    m_regionCursor = reinterpret_cast<char *>(start);
+    m_regionEnd = m_regionCursor + REGION_SIZE;
+    m_hugeAdvised = m_regionCursor;
+    m_hugePageRegions++;
+    return true;
+#endif
+}
+
+void PageHeap::retireRegion()
+{
+    if (m_regionCursor == nullptr || m_regionCursor == m_regionEnd)
+    {
+        m_regionCursor = m_regionEnd = m_hugeAdvised = nullptr;
+        return;
+    }
+    size_t numPages = (m_regionEnd - m_regionCursor) / PAGE_SIZE;
+    Span *span = newSpan();
+    // 元数据分配失败时只是丢弃剩余的虚拟地址空间
+    if (span != nullptr && m_pageMap->ensure(PageMap::pageIdOf(m_regionCursor), numPages))
+    {
+        span->pageAddr = m_regionCursor;
+        span->numPages = numPages;
+        span->state = PageState::Clean;
+        span->freeEpoch = m_epoch->load(std::memory_order_relaxed);
+        pushFreeSpan(coalesce(span));
+    }
+    else
+    {
+        m_spanPool.deleteObject(span);
+    }
+    m_regionCursor = m_regionEnd = m_hugeAdvised = nullptr;
+}
+} // namespace MemoryPool_V2
\ No newline at end of file
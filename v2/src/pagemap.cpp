@@ -0,0 +1,43 @@
+#include "../include/pagemap.h"
+
+namespace MemoryPool_V2
+{
+bool PageMap::ensure(size_t pageId, size_t numPages)
+{
+    std::lock_guard<std::mutex> lock(m_growMutex);
+    for (size_t key = pageId; key < pageId + numPages;)
+    {
+        if ((key >> PAGE_ID_BITS) != 0)
+        {
+            return false;
+        }
+
+        auto &rootEntry = m_root[key >> (LEAF_BITS + INTERIOR_BITS)];
+        Interior *interior = rootEntry.load(std::memory_order_relaxed);
+        if (interior == nullptr)
+        {
+            interior = m_interiorPool.newObject();
+            if (interior == nullptr)
+            {
+                return false;
+            }
+            rootEntry.store(interior, std::memory_order_release);
+        }
+
+        auto &interiorEntry = interior->leafs[(key >> LEAF_BITS) & (INTERIOR_LENGTH - 1)];
+        if (interiorEntry.load(std::memory_order_relaxed) == nullptr)
+        {
+            Leaf *leaf = m_leafPool.newObject();
+            if (leaf == nullptr)
+            {
+                return false;
+            }
+            interiorEntry.store(leaf, std::memory_order_release);
+        }
+
+        // 跳到下一个叶子节点覆盖的范围
+        key = ((key >> LEAF_BITS) + 1) << LEAF_BITS;
+    }
+    return true;
+}
+} // namespace MemoryPool_V2
@@ -0,0 +1,51 @@
+#include "../include/remotefreequeue.h"
+#include "../include/objectpool.h"
+
+#include <mutex>
+
+namespace MemoryPool_V2
+{
+namespace
+{
+std::mutex g_registryMutex;
+ObjectPool<RemoteFreeQueue> g_queuePool;
+RemoteFreeQueue *g_freeQueues = nullptr;
+} // namespace
+
+RemoteFreeQueue *RemoteFreeQueue::acquire()
+{
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    RemoteFreeQueue *queue = g_freeQueues;
+    if (queue != nullptr)
+    {
+        // 复用已退出线程的队列，失效时已取出全部剩余块
+        g_freeQueues = queue->m_nextFree;
+        queue->m_nextFree = nullptr;
+    }
+    else
+    {
+        queue = g_queuePool.newObject();
+        if (queue == nullptr)
+        {
+            return nullptr;
+        }
+    }
+    // 积压字节数不清零：失效前预留的压入会自行回退，取出的块由上一任所属线程扣除
+    queue->m_head.store(nullptr, std::memory_order_release);
+    return queue;
+}
+
+void *RemoteFreeQueue::release(RemoteFreeQueue *queue)
+{
+    if (queue == nullptr)
+    {
+        return nullptr;
+    }
+    // 失效后不再有块压入，取出的就是全部剩余
+    void *pending = queue->m_head.exchange(closedMark(), std::memory_order_acquire);
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    queue->m_nextFree = g_freeQueues;
+    g_freeQueues = queue;
+    return pending;
+}
+} // namespace MemoryPool_V2
@@ -0,0 +1,66 @@
+#include "../include/scavenger.h"
+#include "../include/centralcache.h"
+#include "../include/pagecache.h"
+
+namespace MemoryPool_V2
+{
+void Scavenger::start(const ScavengerOptions &options)
+{
+    std::lock_guard<std::mutex> control(m_controlMutex);
+    stopThread();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_options = options;
+    m_running = true;
+    m_thread = std::thread(&Scavenger::run, this);
+}
+
+void Scavenger::stop()
+{
+    std::lock_guard<std::mutex> control(m_controlMutex);
+    stopThread();
+}
+
+void Scavenger::stopThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_cond.notify_all();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+bool Scavenger::isRunning()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_running;
+}
+
+void Scavenger::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_running)
+    {
+        if (m_cond.wait_for(lock, m_options.interval, [this] { return !m_running; }))
+        {
+            break;
+        }
+        ScavengerOptions options = m_options;
+        lock.unlock();
+
+        // 先交还中心缓存的空闲 span，本周期即可参与 PageCache 的合并与衰减
+        CentralCache *centralCache = CentralCache::getInstance();
+        centralCache->advanceEpoch();
+        centralCache->reclaimIdleSpans(options.idleSpanEpochs, options.maxSpansPerTick);
+
+        PageCache *pageCache = PageCache::getInstance();
+        pageCache->advanceEpoch();
+        pageCache->releaseIdlePages(options.dirtyDecayEpochs, options.muzzyDecayEpochs, options.maxPagesPerTick);
+
+        lock.lock();
+    }
+}
+} // namespace MemoryPool_V2
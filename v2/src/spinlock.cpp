@@ -0,0 +1,82 @@
+#include "../include/spinlock.h"
+
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+namespace MemoryPool_V2
+{
+namespace
+{
+// 自旋等待时提示 CPU 降低功耗、让出流水线给同核的超线程
+inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+} // namespace
+
+void SpinLock::lockSlow()
+{
+    uint64_t sleeps = 0;
+    // 临界区都很短，持锁线程通常很快释放，先自旋
+    for (int i = 0; i < SPIN_COUNT; i++)
+    {
+        uint32_t expected = UNLOCKED;
+        if (m_state.load(std::memory_order_relaxed) == UNLOCKED &&
+            m_state.compare_exchange_weak(expected, LOCKED, std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            bump(m_acquisitions);
+            bump(m_contentions);
+            return;
+        }
+        cpuRelax();
+    }
+
+    // 仍拿不到则标记有等待者并睡眠，拿到锁时状态保持为 SLEEPING，解锁时可能多唤醒一次，但不会漏唤醒
+    while (m_state.exchange(SLEEPING, std::memory_order_acquire) != UNLOCKED)
+    {
+        wait();
+        sleeps++;
+    }
+    bump(m_acquisitions);
+    bump(m_contentions);
+    m_sleeps.store(m_sleeps.load(std::memory_order_relaxed) + sleeps, std::memory_order_relaxed);
+}
+
+void SpinLock::wait()
+{
+#if defined(__linux__)
+    // 状态仍为 SLEEPING 时才睡眠，期间被解锁则立即返回
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&m_state), FUTEX_WAIT_PRIVATE, SLEEPING, nullptr, nullptr, 0);
+#else
+    std::this_thread::yield();
+#endif
+}
+
+void SpinLock::wake()
+{
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&m_state), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#endif
+}
+
+LockStats SpinLock::stats() const
+{
+    LockStats stats;
+    stats.acquisitions = m_acquisitions.load(std::memory_order_relaxed);
+    stats.contentions = m_contentions.load(std::memory_order_relaxed);
+    stats.sleeps = m_sleeps.load(std::memory_order_relaxed);
+    return stats;
+}
+} // namespace MemoryPool_V2
@@ -1,10 +1,33 @@
 #include "../include/centralcache.h"
+#include "../include/objectpool.h"
+#include "../include/pagecache.h"
+#include "../include/pagemap.h"
 #include "../include/threadcache.h"
+#include "../include/transfercache.h"
 
-#include <cstdlib>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
 
 namespace MemoryPool_V2
 {
+// 线程缓存注册表：全局预算与所有线程缓存组成的链表，均受 s_registryMutex 保护
+// 只在线程创建/退出和容量调整时加锁，分配释放的快速路径不涉及
+static std::mutex s_registryMutex;
+static ThreadCache *s_cacheList = nullptr;
+static ThreadCache *s_nextVictim = nullptr; // 下一个被窃取容量的线程，轮流选择
+static size_t s_cacheBudget = ThreadCache::DEFAULT_CACHE_BUDGET;
+// 尚未分给任何线程的预算，新线程按下限起步可能使其暂时为负
+static ptrdiff_t s_unclaimedBytes = static_cast<ptrdiff_t>(ThreadCache::DEFAULT_CACHE_BUDGET);
+
+// 数组布局的指针数组池，线程退出时归还的数组留给新线程复用，同样受 s_registryMutex 保护
+static ObjectPool<ThreadCache::FreeStack> s_stackPool;
+
+static const size_t MAX_LIST_LENGTH = 8192; // 单个自由链表长度上限的最大值
+static const size_t MAX_OVERAGES = 3;       // 连续溢出这么多次后缩小链表长度上限
+
 void *ThreadCache::allocate(size_t size)
 {
     if (size == 0)
@@ -14,24 +37,39 @@ void *ThreadCache::allocate(size_t size)
 
     if (size > MAX_BYTES)
     {
-        // 大对象直接从系统分配
-        return malloc(size);
+        // 大对象直接按页从PageCache分配
+        return allocateLarge(size);
     }
 
     size_t index = SizeClass::getIndex(size);
+    if (m_passThrough)
+    {
+        void *ptr = nullptr;
+        return CentralCache::getInstance()->fetchBatch(&ptr, 1, index) == 0 ? nullptr : ptr;
+    }
 
     // 检查线程本地自由链表
-    // 如果 m_freeList[index] 不为空，表示该链表中有可用内存块
-    if (m_freeList[index] != nullptr)
-    {
-        // 更新对应自由链表的长度计数
-        m_freeListSize[index]--;
-        void *ptr = m_freeList[index];
-        m_freeList[index] =
-            *reinterpret_cast<void **>(ptr); // 将m_freeList[index]指向的内存块的下一个内存块地址（取决于内存块的实现）
+    if (m_freeListSize[index] > 0)
+    {
+        void *ptr = popLocal(index);
+        if (m_freeListSize[index] < m_lowMark[index])
+        {
+            m_lowMark[index] = m_freeListSize[index];
+        }
         return ptr;
     }
 
+    // 未命中时先取回其他线程归还的块
+    if (m_remoteQueue != nullptr)
+    {
+        drainRemoteFrees(m_remoteQueue);
+        if (m_freeListSize[index] > 0)
+        {
+            m_lowMark[index] = 0;
+            return popLocal(index);
+        }
+    }
+
     return fetchFromCentralCache(index);
 }
 
@@ -39,90 +77,559 @@ void ThreadCache::deallocate(void *ptr, size_t size)
 {
     if (size > MAX_BYTES)
     {
-        free(ptr);
+        deallocateLarge(ptr);
         return;
     }
-
+    // 用户写过的块不再全为 0，标记后 allocateZeroed 再领取时会完整清零
     size_t index = SizeClass::getIndex(size);
-    *reinterpret_cast<void **>(ptr) = m_freeList[index];
-    m_freeList[index] = ptr;
+    markBlockDirty(ptr, SizeClass::classSize(index));
+    if (m_passThrough)
+    {
+        CentralCache::getInstance()->returnBatch(&ptr, 1, index);
+        return;
+    }
+
+    // 跨线程释放：块所属 span 由其他存活线程独占（所有交出的块都在它手中），交给它的远程释放队列
+    Span *span = PageMap::getInstance()->get(ptr);
+    if (span != nullptr)
+    {
+        RemoteFreeQueue *owner = span->owner.load(std::memory_order_relaxed);
+        if (owner != nullptr && owner != m_remoteQueue && owner->push(ptr, SizeClass::classSize(index)))
+        {
+            return;
+        }
+    }
+
+    pushLocal(ptr, index);
+}
+
+void *ThreadCache::popLocal(size_t index)
+{
+    m_freeListSize[index]--;
+    m_size -= SizeClass::classSize(index);
+    if (m_arrayMode)
+    {
+        void **slots = m_stacks[index]->slots;
+        void *ptr = slots[m_freeListSize[index]];
+        if (m_freeListSize[index] > 0)
+        {
+            // 下一次分配返回的块，提前取进缓存
+            MEMORYPOOL_PREFETCH(slots[m_freeListSize[index] - 1]);
+        }
+        return ptr;
+    }
+    void *ptr = m_freeList[index];
+    m_freeList[index] =
+        *reinterpret_cast<void **>(ptr); // 将m_freeList[index]指向的内存块的下一个内存块地址（取决于内存块的实现）
+    return ptr;
+}
+
+void ThreadCache::pushLocal(void *ptr, size_t index)
+{
+    if (m_arrayMode)
+    {
+        FreeStack *stack = stackFor(index);
+        if (stack == nullptr)
+        {
+            // 取不到指针数组，直接归还中心缓存
+            CentralCache::getInstance()->returnBatch(&ptr, 1, index);
+            return;
+        }
+        if (m_freeListSize[index] == STACK_CAPACITY)
+        {
+            releaseBlocks(index, SizeClass::numMoveSize(SizeClass::classSize(index)));
+        }
+        stack->slots[m_freeListSize[index]] = ptr;
+    }
+    else
+    {
+        *reinterpret_cast<void **>(ptr) = m_freeList[index];
+        m_freeList[index] = ptr;
+    }
 
     m_freeListSize[index]++;
-    if (shouldReturnToCentralCache(index))
+    m_size += SizeClass::classSize(index);
+    if (m_freeListSize[index] > m_maxLength[index])
+    {
+        listTooLong(index);
+    }
+    else if (m_size > m_maxSize.load(std::memory_order_relaxed))
     {
-        returnToCentralCache(m_freeList[index], size);
+        scavenge();
     }
 }
 
-bool ThreadCache::shouldReturnToCentralCache(size_t index)
+void ThreadCache::drainRemoteFrees(RemoteFreeQueue *queue)
 {
-    // 简单策略：当自由链表大小超过一定阈值时，归还部分内存给中心缓存
-    const size_t THRESHOLD = 64; // 可以根据需要调整阈值
-    return m_freeListSize[index] > THRESHOLD;
+    if (queue != nullptr)
+    {
+        pushRemoteBlocks(queue, queue->popAll());
+    }
 }
 
-void ThreadCache::returnToCentralCache(void *start, size_t size)
+void ThreadCache::pushRemoteBlocks(RemoteFreeQueue *queue, void *list)
 {
-    size_t index = SizeClass::getIndex(size);
-    size_t alignedSize = SizeClass::roundUp(size);
-    size_t totalNum = m_freeListSize[index];
+    size_t bytes = 0;
+    void *current = list;
+    while (current != nullptr)
+    {
+        void *next = *reinterpret_cast<void **>(current);
+        Span *span = PageMap::getInstance()->get(current);
+        if (span != nullptr && span->objSize != 0)
+        {
+            // 压入时按大小类的块大小计数
+            size_t index = SizeClass::getIndex(span->objSize);
+            bytes += SizeClass::classSize(index);
+            pushLocal(current, index);
+        }
+        current = next;
+    }
+    if (queue != nullptr)
+    {
+        queue->drained(bytes);
+    }
+}
+
+void *ThreadCache::allocateAligned(size_t size, size_t alignment)
+{
+    if (alignment <= ALIGNMENT)
+    {
+        return allocate(size);
+    }
+    if (size == 0)
+    {
+        size = ALIGNMENT;
+    }
 
-    if (totalNum <= 1)
+    if (size <= MAX_BYTES && alignment <= PageCache::PAGE_SIZE)
+    {
+        size_t index = SizeClass::alignedIndex(size, alignment);
+        if (index < FREE_LIST_SIZE)
+        {
+            return allocate(SizeClass::classSize(index));
+        }
+    }
+    return allocateLargeAligned(size, alignment);
+}
+
+void *ThreadCache::allocateLargeAligned(size_t size, size_t alignment)
+{
+    // 按页分配，超过页大小的对齐要求多申请一些再向上取整
+    size_t extra = alignment > PageCache::PAGE_SIZE ? alignment - PageCache::PAGE_SIZE : 0;
+    if (size > SIZE_MAX - extra)
+    {
+        return nullptr;
+    }
+    void *ptr = allocateLarge(size + extra);
+    if (ptr == nullptr)
+    {
+        return nullptr;
+    }
+    uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+    return reinterpret_cast<void *>((addr + alignment - 1) & ~(alignment - 1));
+}
+
+void ThreadCache::deallocate(void *ptr)
+{
+    Span *span = PageMap::getInstance()->get(ptr);
+    if (span == nullptr || !span->isUse)
+    {
+        // 不是内存池分配的内存
+        return;
+    }
+    if (span->objSize == 0)
+    {
+        deallocateLarge(ptr);
         return;
+    }
+    deallocate(ptr, span->objSize);
+}
 
-    // 保留四分之一在 ThreadCache 中，其他归还给 CentralCache
-    size_t keepNum = std::max(totalNum / 4, size_t(1));
-    size_t returnNum = totalNum - keepNum;
+size_t ThreadCache::usableSize(void *ptr)
+{
+    Span *span = PageMap::getInstance()->get(ptr);
+    if (span == nullptr || !span->isUse)
+    {
+        return 0;
+    }
+    if (span->objSize == 0)
+    {
+        // 按页分配的大对象，可用到 span 末尾
+        char *spanEnd = static_cast<char *>(span->pageAddr) + span->numPages * PageCache::PAGE_SIZE;
+        return spanEnd - static_cast<char *>(ptr);
+    }
+    return span->objSize;
+}
 
-    // 保留的串联起来
-    char *current = static_cast<char *>(start);
-    char *splitNode = current;
-    for (size_t i = 0; i < keepNum - 1; i++)
+void *ThreadCache::allocateZeroed(size_t size)
+{
+    if (size > MAX_BYTES)
     {
-        splitNode = reinterpret_cast<char *>(*reinterpret_cast<void **>(splitNode));
-        if (splitNode == nullptr)
+        bool zeroed = false;
+        void *ptr = allocateLarge(size, &zeroed);
+        if (ptr != nullptr && !zeroed)
         {
-            returnNum = totalNum - i - 1;
-            break;
+            memset(ptr, 0, size);
         }
+        return ptr;
+    }
+    void *ptr = allocate(size);
+    if (ptr != nullptr)
+    {
+        zeroBlock(ptr, size);
     }
+    return ptr;
+}
 
-    if (splitNode != nullptr)
+void *ThreadCache::allocateLarge(size_t size, bool *zeroed)
+{
+    if (size > SIZE_MAX - PageCache::PAGE_SIZE)
     {
-        // 将链表断开
-        void *nextNode = *reinterpret_cast<void **>(splitNode);
-        *reinterpret_cast<void **>(splitNode) = nullptr;
+        return nullptr;
+    }
+    size_t numPages = (size + PageCache::PAGE_SIZE - 1) / PageCache::PAGE_SIZE;
+    return PageCache::getInstance()->allocateSpan(numPages, zeroed);
+}
 
-        m_freeList[index] = start;
-        m_freeListSize[index] = keepNum;
+void ThreadCache::deallocateLarge(void *ptr)
+{
+    // 对齐分配返回的地址可能不在 span 起始处，统一通过页表找到所属 span
+    Span *span = PageMap::getInstance()->get(ptr);
+    if (span == nullptr || !span->isUse || span->objSize != 0)
+    {
+        return;
+    }
+    PageCache::getInstance()->deallocateSpan(span->pageAddr);
+}
 
-        if (returnNum > 0 && nextNode != nullptr)
+void ThreadCache::flush()
+{
+    drainRemoteFrees(m_remoteQueue);
+    for (size_t index = 0; index < FREE_LIST_SIZE; index++)
+    {
+        if (m_freeListSize[index] == 0)
+        {
+            continue;
+        }
+        if (m_arrayMode)
         {
-            CentralCache::getInstance()->returnRange(nextNode, returnNum * alignedSize, index);
+            CentralCache::getInstance()->returnBatch(m_stacks[index]->slots, m_freeListSize[index], index);
         }
+        else
+        {
+            size_t blockSize = SizeClass::classSize(index);
+            CentralCache::getInstance()->returnRange(m_freeList[index], m_freeListSize[index] * blockSize, index);
+        }
+        m_freeList[index] = nullptr;
+        m_freeListSize[index] = 0;
+        m_lowMark[index] = 0;
+    }
+    m_size = 0;
+}
+
+void ThreadCache::listTooLong(size_t index)
+{
+    // 超过上限时归还一批（与中心缓存之间的搬运批量相同）
+    size_t batchNum = SizeClass::numMoveSize(SizeClass::classSize(index));
+    releaseBlocks(index, batchNum);
+
+    // 上限还在慢启动阶段时继续增长；否则连续溢出多次（期间没有未命中）说明上限偏大，减少一批，但不低于一批
+    if (m_maxLength[index] < batchNum)
+    {
+        m_maxLength[index]++;
+    }
+    else if (++m_overages[index] > MAX_OVERAGES)
+    {
+        if (m_maxLength[index] > batchNum)
+        {
+            m_maxLength[index] = std::max(m_maxLength[index] - batchNum, batchNum);
+        }
+        m_overages[index] = 0;
     }
 }
 
 void *ThreadCache::fetchFromCentralCache(size_t index)
 {
-    void *start = CentralCache::getInstance()->fetchRange(index);
-    if (start == nullptr)
+    // 慢启动：链表上限未达到一批时每次未命中加一，之后每次增加一批，
+    // 经常未命中的大小类上限逐渐变大，不再在阈值附近与中心缓存来回搬运
+    size_t size = SizeClass::classSize(index);
+    size_t moveNum = SizeClass::numMoveSize(size);
+    size_t batchNum = std::max(std::min(m_maxLength[index], moveNum), size_t(1));
+    // 未命中说明上限并不偏大，重新累计溢出次数
+    m_overages[index] = 0;
+    if (m_maxLength[index] < moveNum)
+    {
+        m_maxLength[index]++;
+    }
+    else
+    {
+        // 数组布局下上限受指针数组容量限制，留一个位置给超限前的最后一次压入
+        size_t maxLength = m_arrayMode ? STACK_CAPACITY - 1 : MAX_LIST_LENGTH;
+        size_t newLength = std::min(m_maxLength[index] + moveNum, maxLength);
+        m_maxLength[index] = newLength - newLength % moveNum;
+    }
+
+    if (m_remoteQueue == nullptr)
+    {
+        m_remoteQueue = RemoteFreeQueue::acquire();
+    }
+    if (m_arrayMode)
+    {
+        return fetchIntoStack(index, batchNum);
+    }
+
+    void *start = nullptr;
+    void *end = nullptr;
+    size_t actualNum = TransferCache::getInstance()->fetchRange(start, end, batchNum, index, m_remoteQueue);
+    if (actualNum == 0)
     {
         return nullptr;
     }
 
     // 取一个返回，其余放入自由链表
     void *res = start;
-    m_freeList[index] = *reinterpret_cast<void **>(start);
-    size_t totalNum = 0;
-    void *current = start;
-    while (current != nullptr)
+    if (actualNum > 1)
     {
-        totalNum++;
-        current = *reinterpret_cast<void **>(current);
+        *reinterpret_cast<void **>(end) = m_freeList[index];
+        m_freeList[index] = *reinterpret_cast<void **>(start);
+        m_freeListSize[index] += actualNum - 1; // 减去一个返回的
+        m_size += (actualNum - 1) * size;
     }
-    m_freeListSize[index] += (totalNum - 1); // 减去一个返回的
+    // 未命中说明该大小类的块都用上了，下次回收时不从中归还
+    m_lowMark[index] = 0;
     return res;
 }
 
+void *ThreadCache::fetchIntoStack(size_t index, size_t batchNum)
+{
+    FreeStack *stack = stackFor(index);
+    if (stack == nullptr)
+    {
+        // 取不到指针数组，只取一个块直接返回
+        void *ptr = nullptr;
+        return CentralCache::getInstance()->fetchBatch(&ptr, 1, index, m_remoteQueue) == 0 ? nullptr : ptr;
+    }
+    // 传输缓存或中心缓存把块地址直接写到栈顶之上，不需要串链表
+    size_t count = m_freeListSize[index];
+    batchNum = std::min(batchNum, STACK_CAPACITY - count);
+    size_t actualNum = TransferCache::getInstance()->fetchBatch(stack->slots + count, batchNum, index, m_remoteQueue);
+    if (actualNum == 0)
+    {
+        return nullptr;
+    }
+    m_freeListSize[index] += actualNum;
+    m_size += actualNum * SizeClass::classSize(index);
+    m_lowMark[index] = 0;
+    return popLocal(index);
+}
+
+void ThreadCache::releaseBlocks(size_t index, size_t num)
+{
+    num = std::min(num, m_freeListSize[index]);
+    if (num == 0)
+    {
+        return;
+    }
+    size_t blockSize = SizeClass::classSize(index);
+    if (m_arrayMode)
+    {
+        // 归还栈底较早释放的块，其余整体下移
+        void **slots = m_stacks[index]->slots;
+        TransferCache::getInstance()->returnBatch(slots, num, index);
+        memmove(slots, slots + num, (m_freeListSize[index] - num) * sizeof(void *));
+    }
+    else
+    {
+        // 归还 num 个块后返回剩余链表，切分不需要额外遍历
+        m_freeList[index] = TransferCache::getInstance()->returnRange(m_freeList[index], num * blockSize, index);
+    }
+    m_freeListSize[index] -= num;
+    m_size -= num * blockSize;
+}
+
+void ThreadCache::scavenge()
+{
+    // 低水位之上的块在上个周期里从未被用到，每次归还其中一半，
+    // 经常未命中的大小类低水位为 0，不受影响
+    for (size_t index = 0; index < FREE_LIST_SIZE; index++)
+    {
+        size_t lowMark = m_lowMark[index];
+        if (lowMark > 0)
+        {
+            releaseBlocks(index, lowMark > 1 ? lowMark / 2 : 1);
+        }
+        m_lowMark[index] = m_freeListSize[index];
+    }
+    increaseCacheLimit();
+
+    // 扩容失败仍超出容量时，各大小类逐轮减半，保证不超过容量
+    while (m_size > m_maxSize.load(std::memory_order_relaxed))
+    {
+        for (size_t index = 0; index < FREE_LIST_SIZE; index++)
+        {
+            releaseBlocks(index, (m_freeListSize[index] + 1) / 2);
+            m_lowMark[index] = m_freeListSize[index];
+        }
+    }
+}
+
+void ThreadCache::increaseCacheLimit()
+{
+    std::lock_guard<std::mutex> guard(s_registryMutex);
+    if (s_unclaimedBytes >= static_cast<ptrdiff_t>(STEAL_BYTES))
+    {
+        s_unclaimedBytes -= STEAL_BYTES;
+        m_maxSize.fetch_add(STEAL_BYTES, std::memory_order_relaxed);
+        return;
+    }
+    // 预算已分完，从其他线程窃取，被窃取的线程在下次超出容量时自行归还
+    const int MAX_TRIES = 10;
+    for (int i = 0; i < MAX_TRIES; i++)
+    {
+        if (s_nextVictim == nullptr)
+        {
+            s_nextVictim = s_cacheList;
+        }
+        ThreadCache *victim = s_nextVictim;
+        s_nextVictim = victim->m_next;
+        if (victim == this)
+        {
+            continue;
+        }
+        size_t victimSize = victim->m_maxSize.load(std::memory_order_relaxed);
+        if (victimSize >= MIN_CACHE_BYTES + STEAL_BYTES)
+        {
+            victim->m_maxSize.store(victimSize - STEAL_BYTES, std::memory_order_relaxed);
+            m_maxSize.fetch_add(STEAL_BYTES, std::memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+std::atomic<bool> &ThreadCache::arrayModeFlag()
+{
+    // getenv 不分配内存，作为 malloc 替换库时也可以安全调用
+    static std::atomic<bool> enabled{[] {
+        const char *env = getenv("MEMORYPOOL_ARRAY_FREELIST");
+        return env != nullptr && env[0] == '1';
+    }()};
+    return enabled;
+}
+
+ThreadCache *ThreadCache::passThroughInstance()
+{
+    // 放在静态存储中且从不析构，进程退出阶段仍可使用
+    alignas(ThreadCache) static char storage[sizeof(ThreadCache)];
+    static ThreadCache *instance = new (storage) ThreadCache(PassThrough());
+    return instance;
+}
+
+void ThreadCache::setArrayMode(bool enable)
+{
+    if (m_passThrough || enable == m_arrayMode)
+    {
+        return;
+    }
+    flush();
+    m_arrayMode = enable;
+    if (enable)
+    {
+        for (size_t &maxLength : m_maxLength)
+        {
+            maxLength = std::min(maxLength, STACK_CAPACITY - 1);
+        }
+    }
+}
+
+ThreadCache::FreeStack *ThreadCache::stackFor(size_t index)
+{
+    FreeStack *stack = m_stacks[index];
+    if (stack == nullptr)
+    {
+        std::lock_guard<std::mutex> guard(s_registryMutex);
+        stack = s_stackPool.newObject();
+        m_stacks[index] = stack;
+    }
+    return stack;
+}
+
+void ThreadCache::releaseStacks()
+{
+    std::lock_guard<std::mutex> guard(s_registryMutex);
+    for (FreeStack *&stack : m_stacks)
+    {
+        s_stackPool.deleteObject(stack);
+        stack = nullptr;
+    }
+}
+
+void ThreadCache::registerCache()
+{
+    std::lock_guard<std::mutex> guard(s_registryMutex);
+    m_maxSize.store(MIN_CACHE_BYTES, std::memory_order_relaxed);
+    s_unclaimedBytes -= static_cast<ptrdiff_t>(MIN_CACHE_BYTES);
+    m_next = s_cacheList;
+    if (s_cacheList != nullptr)
+    {
+        s_cacheList->m_prev = this;
+    }
+    s_cacheList = this;
+}
+
+void ThreadCache::unregisterCache()
+{
+    std::lock_guard<std::mutex> guard(s_registryMutex);
+    if (m_prev != nullptr)
+    {
+        m_prev->m_next = m_next;
+    }
+    else
+    {
+        s_cacheList = m_next;
+    }
+    if (m_next != nullptr)
+    {
+        m_next->m_prev = m_prev;
+    }
+    if (s_nextVictim == this)
+    {
+        s_nextVictim = m_next;
+    }
+    s_unclaimedBytes += static_cast<ptrdiff_t>(m_maxSize.load(std::memory_order_relaxed));
+}
+
+void ThreadCache::setCacheBudget(size_t bytes)
+{
+    std::lock_guard<std::mutex> guard(s_registryMutex);
+    // 各线程容量按新旧预算之比缩放（不低于下限），剩余部分作为未分配预算
+    ptrdiff_t claimed = 0;
+    for (ThreadCache *cache = s_cacheList; cache != nullptr; cache = cache->m_next)
+    {
+        size_t oldSize = cache->m_maxSize.load(std::memory_order_relaxed);
+        size_t newSize = static_cast<size_t>(static_cast<double>(oldSize) * bytes / s_cacheBudget);
+        newSize = std::max(newSize, size_t(MIN_CACHE_BYTES));
+        cache->m_maxSize.store(newSize, std::memory_order_relaxed);
+        claimed += static_cast<ptrdiff_t>(newSize);
+    }
+    s_cacheBudget = std::max(bytes, size_t(1));
+    s_unclaimedBytes = static_cast<ptrdiff_t>(s_cacheBudget) - claimed;
+}
+
+size_t ThreadCache::cacheBudget()
+{
+    std::lock_guard<std::mutex> guard(s_registryMutex);
+    return s_cacheBudget;
+}
+
+size_t ThreadCache::totalCacheLimit()
+{
+    std::lock_guard<std::mutex> guard(s_registryMutex);
+    size_t total = 0;
+    for (ThreadCache *cache = s_cacheList; cache != nullptr; cache = cache->m_next)
+    {
+        total += cache->m_maxSize.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
 } // namespace MemoryPool_V2
\ No newline at end of file
@@ -0,0 +1,185 @@
+#include "../include/transfercache.h"
+#include "../include/centralcache.h"
+#include "../include/objectpool.h"
+#include "../include/pagemap.h"
+
+#include <cstring>
+#include <mutex>
+
+namespace MemoryPool_V2
+{
+size_t TransferCache::capacity(size_t index)
+{
+    size_t size = SizeClass::classSize(index);
+    size_t batchNum = SizeClass::numMoveSize(size);
+    size_t blocks = MAX_CACHED_BYTES / size;
+    if (blocks > MAX_CACHED_BLOCKS)
+    {
+        blocks = MAX_CACHED_BLOCKS;
+    }
+    return blocks - blocks % batchNum;
+}
+
+bool TransferCache::insertBatch(void *const *batch, size_t index)
+{
+    size_t batchNum = SizeClass::numMoveSize(SizeClass::classSize(index));
+    size_t limit = capacity(index);
+    if (limit == 0)
+    {
+        return false;
+    }
+    TransferList &list = m_lists[index];
+    std::lock_guard<SpinLock> guard(list.lock);
+    if (list.slots == nullptr)
+    {
+        list.slots = static_cast<void **>(metadataAlloc(limit * sizeof(void *)));
+    }
+    if (list.slots == nullptr || list.used + batchNum > limit)
+    {
+        bump(list.insertMisses);
+        return false;
+    }
+    memcpy(list.slots + list.used, batch, batchNum * sizeof(void *));
+    list.used += batchNum;
+    bump(list.insertHits);
+    return true;
+}
+
+bool TransferCache::removeBatch(void **batch, size_t index)
+{
+    size_t batchNum = SizeClass::numMoveSize(SizeClass::classSize(index));
+    if (capacity(index) == 0)
+    {
+        return false;
+    }
+    TransferList &list = m_lists[index];
+    std::lock_guard<SpinLock> guard(list.lock);
+    if (list.used < batchNum)
+    {
+        bump(list.removeMisses);
+        return false;
+    }
+    // 取最近放入的一批，这些块更可能还在缓存中
+    list.used -= batchNum;
+    memcpy(batch, list.slots + list.used, batchNum * sizeof(void *));
+    bump(list.removeHits);
+    return true;
+}
+
+void TransferCache::clearOwners(void *const *batch, size_t num)
+{
+    // 整批转手后 span 的块分散在多个线程手中，清除归属，领取方释放自己的块时留在本地
+    // span 有块在外时中心缓存只会清除归属而不会重新设置，这里不必加大小类的锁
+    PageMap *pageMap = PageMap::getInstance();
+    Span *last = nullptr;
+    for (size_t i = 0; i < num; i++)
+    {
+        Span *span = pageMap->get(batch[i]);
+        if (span != nullptr && span != last)
+        {
+            span->owner.store(nullptr, std::memory_order_relaxed);
+            last = span;
+        }
+    }
+}
+
+size_t TransferCache::fetchRange(void *&start, void *&end, size_t batchNum, size_t index, RemoteFreeQueue *owner)
+{
+    void *batch[MAX_BATCH_NUM];
+    if (index < FREE_LIST_SIZE && batchNum == SizeClass::numMoveSize(SizeClass::classSize(index)) &&
+        removeBatch(batch, index))
+    {
+        clearOwners(batch, batchNum);
+        // 在锁外把整批串成链表
+        for (size_t i = 0; i + 1 < batchNum; i++)
+        {
+            *reinterpret_cast<void **>(batch[i]) = batch[i + 1];
+        }
+        *reinterpret_cast<void **>(batch[batchNum - 1]) = nullptr;
+        start = batch[0];
+        end = batch[batchNum - 1];
+        return batchNum;
+    }
+    return CentralCache::getInstance()->fetchRange(start, end, batchNum, index, owner);
+}
+
+void *TransferCache::returnRange(void *start, size_t size, size_t index)
+{
+    if (start != nullptr && index < FREE_LIST_SIZE)
+    {
+        size_t blockSize = SizeClass::classSize(index);
+        size_t batchNum = SizeClass::numMoveSize(blockSize);
+        if (size / blockSize == batchNum && capacity(index) != 0)
+        {
+            // 在锁外收集整批的块地址，链表不足一批时交给中心缓存处理
+            void *batch[MAX_BATCH_NUM];
+            void *current = start;
+            size_t num = 0;
+            while (num < batchNum && current != nullptr)
+            {
+                batch[num++] = current;
+                current = *reinterpret_cast<void **>(current);
+            }
+            if (num == batchNum && insertBatch(batch, index))
+            {
+                return current;
+            }
+        }
+    }
+    return CentralCache::getInstance()->returnRange(start, size, index);
+}
+
+size_t TransferCache::fetchBatch(void **batch, size_t batchNum, size_t index, RemoteFreeQueue *owner)
+{
+    if (index < FREE_LIST_SIZE && batchNum == SizeClass::numMoveSize(SizeClass::classSize(index)) &&
+        removeBatch(batch, index))
+    {
+        clearOwners(batch, batchNum);
+        return batchNum;
+    }
+    return CentralCache::getInstance()->fetchBatch(batch, batchNum, index, owner);
+}
+
+void TransferCache::returnBatch(void *const *batch, size_t num, size_t index)
+{
+    if (index < FREE_LIST_SIZE && num == SizeClass::numMoveSize(SizeClass::classSize(index)) &&
+        insertBatch(batch, index))
+    {
+        return;
+    }
+    CentralCache::getInstance()->returnBatch(batch, num, index);
+}
+
+void TransferCache::flush()
+{
+    for (size_t index = 0; index < FREE_LIST_SIZE; index++)
+    {
+        TransferList &list = m_lists[index];
+        std::lock_guard<SpinLock> guard(list.lock);
+        if (list.used > 0)
+        {
+            CentralCache::getInstance()->returnBatch(list.slots, list.used, index);
+            list.used = 0;
+        }
+    }
+}
+
+TransferCacheStats TransferCache::getStats() const
+{
+    TransferCacheStats stats;
+    for (const TransferList &list : m_lists)
+    {
+        stats.insertHits += list.insertHits.load(std::memory_order_relaxed);
+        stats.insertMisses += list.insertMisses.load(std::memory_order_relaxed);
+        stats.removeHits += list.removeHits.load(std::memory_order_relaxed);
+        stats.removeMisses += list.removeMisses.load(std::memory_order_relaxed);
+    }
+    for (size_t index = 0; index < FREE_LIST_SIZE; index++)
+    {
+        TransferList &list = const_cast<TransferList &>(m_lists[index]);
+        std::lock_guard<SpinLock> guard(list.lock);
+        stats.cachedBlocks += list.used;
+    }
+    return stats;
+}
+} // namespace MemoryPool_V2
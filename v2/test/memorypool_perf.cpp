@@ -1,4 +1,7 @@
+#include "../include/centralcache.h"
 #include "../include/memorypool.h"
+#include "../include/transfercache.h"
+#include <algorithm>
 #include <array>
 #include <chrono>
 #include <iomanip>
@@ -473,6 +476,207 @@ class PerformanceTest
             std::cout << "New/Delete: " << std::fixed << std::setprecision(3) << t.elapsed() << " ms" << std::endl;
         }
     }
+
+    // 中心缓存各大小类锁的累计统计
+    static void printCentralLockStats()
+    {
+        LockStats total;
+        for (size_t index = 0; index < FREE_LIST_SIZE; ++index)
+        {
+            LockStats stats = CentralCache::getInstance()->lockStats(index);
+            total.acquisitions += stats.acquisitions;
+            total.contentions += stats.contentions;
+            total.sleeps += stats.sleeps;
+        }
+        std::cout << "Central cache locks: " << total.acquisitions << " acquisitions, " << total.contentions
+                  << " contended, " << total.sleeps << " sleeps" << std::endl;
+    }
+
+    // 5. 阈值附近的批量分配释放：每轮持有的块数在旧的固定阈值（64 块）上下
+    static void testThresholdBounce()
+    {
+        constexpr size_t ROUNDS = 2000;
+        constexpr size_t SIZE = 256;
+
+        std::cout << "\nTesting alloc/free rounds around the old list threshold (" << ROUNDS << " rounds):" << std::endl;
+
+        for (size_t live : {48, 64, 80, 128})
+        {
+            std::vector<void *> ptrs(live);
+            Timer t;
+            for (size_t round = 0; round < ROUNDS; ++round)
+            {
+                for (size_t i = 0; i < live; ++i)
+                {
+                    ptrs[i] = MemoryPool::allocate(SIZE);
+                }
+                for (size_t i = 0; i < live; ++i)
+                {
+                    MemoryPool::deallocate(ptrs[i], SIZE);
+                }
+            }
+            double ms = t.elapsed();
+            std::cout << "Memory Pool (" << live << " live): " << std::fixed << std::setprecision(3) << ms << " ms"
+                      << std::endl;
+        }
+    }
+
+    // 6. 线程缓存自由链表布局对比：先乱序释放大量块，让链表指针落在冷缓存行上，再整批分配
+    static void testFreeListLayouts()
+    {
+        constexpr size_t NUM_BLOCKS = 400;
+        constexpr size_t ROUNDS = 200;
+        constexpr size_t SIZE = 2048; // 合计约 800KB，超出 L2，链表指针多在冷缓存行上
+
+        std::cout << "\nTesting thread cache free list layouts (" << ROUNDS << " rounds of " << NUM_BLOCKS
+                  << " blocks):" << std::endl;
+
+        std::mt19937 rng(42);
+        for (bool arrayMode : {false, true})
+        {
+            MemoryPool::setArrayFreeLists(arrayMode);
+            std::vector<void *> ptrs(NUM_BLOCKS);
+            Timer t;
+            for (size_t round = 0; round < ROUNDS; ++round)
+            {
+                for (size_t i = 0; i < NUM_BLOCKS; ++i)
+                {
+                    ptrs[i] = MemoryPool::allocate(SIZE);
+                }
+                std::shuffle(ptrs.begin(), ptrs.end(), rng);
+                for (void *ptr : ptrs)
+                {
+                    MemoryPool::deallocate(ptr, SIZE);
+                }
+            }
+            std::cout << (arrayMode ? "Array free lists: " : "Linked free lists: ") << std::fixed
+                      << std::setprecision(3) << t.elapsed() << " ms" << std::endl;
+        }
+        MemoryPool::setArrayFreeLists(false);
+    }
+
+    // 7. 页级分配测试：直接在 PageCache 上分配/释放 span，观察随线程数的扩展性
+    static void testPageLevelScaling()
+    {
+        constexpr size_t OPS_PER_THREAD = 50000;
+        constexpr size_t WINDOW = 32; // 每个线程同时持有的 span 数
+
+        std::cout << "\nTesting page-level allocations (" << OPS_PER_THREAD << " span ops per thread):" << std::endl;
+
+        auto threadFunc = [](unsigned seed) {
+            std::mt19937 rng(seed);
+            std::uniform_int_distribution<size_t> pagesDist(1, 64);
+            PageCache *pageCache = PageCache::getInstance();
+            std::array<std::pair<void *, size_t>, WINDOW> spans{};
+            for (size_t i = 0; i < OPS_PER_THREAD; ++i)
+            {
+                auto &slot = spans[i % WINDOW];
+                if (slot.first != nullptr)
+                {
+                    pageCache->deallocateSpan(slot.first);
+                }
+                slot.second = pagesDist(rng);
+                slot.first = pageCache->allocateSpan(slot.second);
+            }
+            for (auto &slot : spans)
+            {
+                if (slot.first != nullptr)
+                {
+                    pageCache->deallocateSpan(slot.first);
+                }
+            }
+        };
+
+        for (size_t numThreads : {1, 2, 4, 8})
+        {
+            Timer t;
+            std::vector<std::thread> threads;
+            for (size_t i = 0; i < numThreads; ++i)
+            {
+                threads.emplace_back(threadFunc, static_cast<unsigned>(i + 1));
+            }
+            for (auto &thread : threads)
+            {
+                thread.join();
+            }
+            double ms = t.elapsed();
+            std::cout << "Page heap (" << numThreads << " threads): " << std::fixed << std::setprecision(3) << ms
+                      << " ms, " << std::setprecision(2) << numThreads * OPS_PER_THREAD / ms / 1000.0 << " Mops/s"
+                      << std::endl;
+        }
+    }
+
+    // 8. 一个线程释放、另一个线程分配：释放方溢出的整批经传输缓存直接交给分配方
+    static void testTransferHandoff()
+    {
+        constexpr size_t ROUNDS = 50;
+        constexpr size_t BLOCKS = 4096;
+        constexpr size_t SIZE = 256;
+
+        std::cout << "\nTesting cross-thread batch handoff (" << ROUNDS << " rounds, " << BLOCKS << " blocks):"
+                  << std::endl;
+
+        TransferCacheStats before = TransferCache::getInstance()->getStats();
+        std::vector<void *> ptrs(BLOCKS);
+        Timer t;
+        for (size_t round = 0; round < ROUNDS; ++round)
+        {
+            std::thread consumer([&ptrs]() {
+                for (void *&ptr : ptrs)
+                {
+                    ptr = MemoryPool::allocate(SIZE);
+                }
+            });
+            consumer.join();
+            std::thread producer([&ptrs]() {
+                for (void *ptr : ptrs)
+                {
+                    MemoryPool::deallocate(ptr, SIZE);
+                }
+            });
+            producer.join();
+        }
+        double ms = t.elapsed();
+        TransferCacheStats after = TransferCache::getInstance()->getStats();
+        std::cout << "Memory Pool: " << std::fixed << std::setprecision(3) << ms << " ms" << std::endl;
+        std::cout << "Transfer cache: inserts " << after.insertHits - before.insertHits << " hit / "
+                  << after.insertMisses - before.insertMisses << " miss, removes "
+                  << after.removeHits - before.removeHits << " hit / " << after.removeMisses - before.removeMisses
+                  << " miss" << std::endl;
+    }
+
+    // 9. span 反复变空再被取用时单次释放的延迟分布，空闲 span 交还 PageCache 不应出现在释放路径上
+    static void testDeallocLatency()
+    {
+        constexpr size_t ROUNDS = 100;
+        constexpr size_t LIVE = 2048;
+        constexpr size_t SIZE = 4096;
+
+        std::cout << "\nTesting deallocate latency with span churn (" << ROUNDS << " rounds, " << LIVE
+                  << " live):" << std::endl;
+
+        std::vector<void *> ptrs(LIVE);
+        std::vector<double> latencies;
+        latencies.reserve(ROUNDS * LIVE);
+        for (size_t round = 0; round < ROUNDS; ++round)
+        {
+            for (void *&ptr : ptrs)
+            {
+                ptr = MemoryPool::allocate(SIZE);
+            }
+            for (void *ptr : ptrs)
+            {
+                auto begin = high_resolution_clock::now();
+                MemoryPool::deallocate(ptr, SIZE);
+                latencies.push_back(duration_cast<nanoseconds>(high_resolution_clock::now() - begin).count());
+            }
+        }
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&latencies](double p) { return latencies[size_t(p * (latencies.size() - 1))]; };
+        std::cout << "Memory Pool: p50 " << std::fixed << std::setprecision(0) << percentile(0.5) << " ns, p99 "
+                  << percentile(0.99) << " ns, p99.9 " << percentile(0.999) << " ns, max " << latencies.back()
+                  << " ns" << std::endl;
+    }
 };
 
 int main()
@@ -483,7 +687,13 @@ int main()
     // 运行测试
     PerformanceTest::testSmallAllocation();
     PerformanceTest::testMultiThreaded();
+    PerformanceTest::printCentralLockStats();
     PerformanceTest::testMixedSizes();
+    PerformanceTest::testThresholdBounce();
+    PerformanceTest::testFreeListLayouts();
+    PerformanceTest::testPageLevelScaling();
+    PerformanceTest::testTransferHandoff();
+    PerformanceTest::testDeallocLatency();
 
     return 0;
 }
\ No newline at end of file
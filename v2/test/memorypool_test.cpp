@@ -1,10 +1,18 @@
 #include "memorypool.h"
+#include "pagemap.h"
+#include "centralcache.h"
+#include "spinlock.h"
+#include "transfercache.h"
+#include <algorithm>
 #include <iostream>
 #include <cassert>
 #include <thread>
 #include <vector>
 #include <chrono>
+#include <atomic>
 #include <cstring>
+#include <pthread.h>
+#include <sys/mman.h>
 
 // 测试基本的分配和释放功能
 void testBasicAllocation() {
@@ -37,6 +45,56 @@ void testBasicAllocation() {
     std::cout << "基本分配释放测试通过！" << std::endl;
 }
 
+// 测试大小类映射：每个大小都落到能容纳它的最小大小类，且浪费受控
+void testSizeClasses() {
+    std::cout << "\n===== 测试大小类映射功能 ======" << std::endl;
+    
+    assert(FREE_LIST_SIZE <= 128);
+    for (size_t size = 1; size <= MAX_BYTES; ++size) {
+        size_t index = SizeClass::getIndex(size);
+        size_t classSize = SizeClass::classSize(index);
+        assert(classSize >= size);
+        assert(index == 0 || SizeClass::classSize(index - 1) < size);
+        if (size > 128) {
+            assert((classSize - size) * 8 <= classSize);
+        }
+    }
+    
+    std::cout << "大小类映射测试通过！共" << FREE_LIST_SIZE << "个大小类" << std::endl;
+}
+
+// 测试不带大小的释放和可用大小查询
+void testSizelessDeallocation() {
+    std::cout << "\n===== 测试不带大小释放功能 ======" << std::endl;
+    
+    for (size_t size : {1, 8, 100, 1000, 5000, 100000, 256 * 1024}) {
+        void* ptr = MemoryPool::allocate(size);
+        assert(ptr != nullptr);
+        assert(MemoryPool::usableSize(ptr) == SizeClass::classSize(SizeClass::getIndex(size)));
+        memset(ptr, 0xab, MemoryPool::usableSize(ptr));
+        MemoryPool::deallocate(ptr);
+    }
+    
+    // 超过 MAX_BYTES 的大对象同样可以不带大小释放
+    void* large = MemoryPool::allocate(MAX_BYTES + 1);
+    assert(large != nullptr);
+    assert(MemoryPool::usableSize(large) >= MAX_BYTES + 1);
+    MemoryPool::deallocate(large);
+    
+    // 对齐分配
+    for (size_t alignment : {16, 64, 4096, 65536}) {
+        for (size_t size : {1, 100, 5000, 300000}) {
+            void* ptr = MemoryPool::allocateAligned(size, alignment);
+            assert(reinterpret_cast<uintptr_t>(ptr) % alignment == 0);
+            assert(MemoryPool::usableSize(ptr) >= size);
+            memset(ptr, 0xcd, size);
+            MemoryPool::deallocate(ptr);
+        }
+    }
+    
+    std::cout << "不带大小释放测试通过！" << std::endl;
+}
+
 // 测试类型安全的分配功能
 void testTypeSafeAllocation() {
     std::cout << "\n===== 测试类型安全分配功能 ======" << std::endl;
@@ -150,14 +208,1082 @@ void testMultithreadedAllocation() {
               << duration.count() << "ms" << std::endl;
 }
 
+// 测试大量 span 同时存活（超过原先 1024 个 span 的上限）
+void testManySpans() {
+    std::cout << "\n===== 测试大量span分配功能 ======" << std::endl;
+    
+    const size_t size = 2048;
+    const size_t count = 40000; // 约 80MB，需要数千个 span
+    
+    std::vector<void*> pointers;
+    pointers.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        void* ptr = MemoryPool::allocate(size);
+        assert(ptr != nullptr);
+        *static_cast<size_t*>(ptr) = i;
+        pointers.push_back(ptr);
+    }
+    
+    for (size_t i = 0; i < count; ++i) {
+        assert(*static_cast<size_t*>(pointers[i]) == i);
+        MemoryPool::deallocate(pointers[i], size);
+    }
+    
+    std::cout << "大量span分配测试通过！" << std::endl;
+}
+
+// 测试线程缓存归还：线程退出和主动调用 flushThreadCache
+void testThreadCacheFlush() {
+    std::cout << "\n===== 测试线程缓存归还功能 ======" << std::endl;
+    
+    const size_t size = 3000;
+    const size_t count = 100;
+    std::vector<void*> pointers;
+    
+    // 子线程退出后，其缓存的内存块应全部回到中心缓存，span 交还给 PageCache
+    std::thread worker([&pointers, size, count]() {
+        for (size_t i = 0; i < count; ++i) {
+            pointers.push_back(MemoryPool::allocate(size));
+        }
+        for (void* ptr : pointers) {
+            MemoryPool::deallocate(ptr, size);
+        }
+    });
+    worker.join();
+    // 运行中超出上限而归还的整批留在传输缓存，供其他线程复用，清空后才回到 span；
+    // 全部空闲的 span 先留在中心缓存，交还后才回到 PageCache
+    TransferCache::getInstance()->flush();
+    CentralCache::getInstance()->releaseIdleSpans();
+    for (void* ptr : pointers) {
+        Span* span = PageMap::getInstance()->get(ptr);
+        assert(span != nullptr && !span->isUse);
+    }
+    
+    // 主动归还当前线程的缓存
+    pointers.clear();
+    for (size_t i = 0; i < count; ++i) {
+        pointers.push_back(MemoryPool::allocate(size));
+    }
+    for (void* ptr : pointers) {
+        MemoryPool::deallocate(ptr, size);
+    }
+    MemoryPool::flushThreadCache();
+    for (void* ptr : pointers) {
+        Span* span = PageMap::getInstance()->get(ptr);
+        assert(span != nullptr && !span->isUse);
+    }
+    
+    std::cout << "线程缓存归还测试通过！" << std::endl;
+}
+
+// 测试跨线程释放：其他线程释放的内存块回到分配线程，而不是滞留在释放线程
+void testCrossThreadDeallocation() {
+    std::cout << "\n===== 测试跨线程释放功能 ======" << std::endl;
+    
+    // 总字节数不超过远程释放队列的积压上限
+    const size_t size = 5000;
+    const size_t count = RemoteFreeQueue::MAX_PENDING_BYTES / 8192;
+    std::vector<void*> pointers;
+    for (size_t i = 0; i < count; ++i) {
+        pointers.push_back(MemoryPool::allocate(size));
+    }
+    
+    // 消费者线程释放主线程分配的内存块，释放完后保持存活
+    std::atomic<bool> freed{false};
+    std::atomic<bool> done{false};
+    std::thread consumer([&]() {
+        for (void* ptr : pointers) {
+            MemoryPool::deallocate(ptr, size);
+        }
+        freed = true;
+        while (!done) {
+            std::this_thread::yield();
+        }
+    });
+    while (!freed) {
+        std::this_thread::yield();
+    }
+    
+    // 这些块应在主线程的远程释放队列中，主线程归还后所有 span 都回到 PageCache
+    MemoryPool::flushThreadCache();
+    for (void* ptr : pointers) {
+        Span* span = PageMap::getInstance()->get(ptr);
+        assert(span != nullptr && !span->isUse);
+    }
+    done = true;
+    consumer.join();
+    
+    std::cout << "跨线程释放测试通过！" << std::endl;
+}
+
+// 测试远程释放队列的积压计数：与取回交错的压入不会让计数漂移
+void testRemoteFreeQueueAccounting() {
+    std::cout << "\n===== 测试远程释放队列计数 ======" << std::endl;
+    
+    RemoteFreeQueue* queue = RemoteFreeQueue::acquire();
+    assert(queue != nullptr && queue->pendingBytes() == 0);
+    
+    // 多个线程持续压入，同时所属线程反复取回
+    const size_t blockSize = 64;
+    const size_t numThreads = 4;
+    const size_t perThread = 20000;
+    std::vector<std::vector<char>> blocks(numThreads, std::vector<char>(perThread * blockSize));
+    std::atomic<size_t> finished{0};
+    auto countList = [](void* list) {
+        size_t num = 0;
+        for (; list != nullptr; list = *reinterpret_cast<void**>(list)) {
+            num++;
+        }
+        return num;
+    };
+    std::vector<std::thread> pushers;
+    for (size_t t = 0; t < numThreads; ++t) {
+        pushers.emplace_back([&, t]() {
+            for (size_t i = 0; i < perThread; ++i) {
+                while (!queue->push(&blocks[t][i * blockSize], blockSize)) {
+                    std::this_thread::yield();
+                }
+            }
+            finished++;
+        });
+    }
+    size_t popped = 0;
+    while (finished < numThreads || queue->pendingBytes() != 0) {
+        size_t num = countList(queue->popAll());
+        queue->drained(num * blockSize);
+        popped += num;
+    }
+    for (auto& pusher : pushers) {
+        pusher.join();
+    }
+    assert(popped == numThreads * perThread);
+    assert(queue->pendingBytes() == 0);
+    
+    // 失效时取出的剩余块同样扣除，队列复用时计数从 0 开始
+    bool pushed = queue->push(&blocks[0][0], blockSize);
+    assert(pushed);
+    void* rest = RemoteFreeQueue::release(queue);
+    queue->drained(countList(rest) * blockSize);
+    assert(queue->pendingBytes() == 0);
+    pushed = queue->push(&blocks[0][blockSize], blockSize);
+    assert(!pushed && queue->pendingBytes() == 0);
+    
+    std::cout << "远程释放队列计数测试通过！" << std::endl;
+}
+
+// 测试空闲页归还操作系统
+void testReleaseFreeMemory() {
+    std::cout << "\n===== 测试空闲页归还功能 ======" << std::endl;
+    
+    const size_t size = 8 * 1024 * 1024;
+    void* ptr = MemoryPool::allocate(size);
+    memset(ptr, 1, size);
+    MemoryPool::deallocate(ptr, size);
+    PageCacheStats freed = PageCache::getInstance()->getStats();
+    assert(freed.dirtyPages + freed.cachedPages >= size / PageCache::PAGE_SIZE);
+    
+    // 手动归还
+    size_t releasedBefore = PageCache::getInstance()->getStats().releasedPages;
+    MemoryPool::releaseFreeMemory();
+    PageCacheStats stats = PageCache::getInstance()->getStats();
+    assert(stats.dirtyPages == 0 && stats.muzzyPages == 0 && stats.cachedPages == 0);
+    assert(stats.releasedPages >= releasedBefore + size / PageCache::PAGE_SIZE);
+    
+    // 后台回收：脏页空闲一个纪元后直接 MADV_DONTNEED
+    ptr = MemoryPool::allocate(size);
+    memset(ptr, 2, size);
+    MemoryPool::deallocate(ptr, size);
+    ScavengerOptions options;
+    options.interval = std::chrono::milliseconds(10);
+    options.dirtyDecayEpochs = 1;
+    options.muzzyDecayEpochs = 0;
+    MemoryPool::startScavenger(options);
+    for (int i = 0; i < 200; ++i) {
+        PageCacheStats current = PageCache::getInstance()->getStats();
+        if (current.dirtyPages == 0 && current.cachedPages == 0) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    MemoryPool::stopScavenger();
+    assert(PageCache::getInstance()->getStats().dirtyPages == 0);
+    assert(PageCache::getInstance()->getStats().cachedPages == 0);
+    
+    // 多个线程并发启停回收线程
+    std::vector<std::thread> controllers;
+    for (int t = 0; t < 4; ++t) {
+        controllers.emplace_back([&options, t]() {
+            for (int i = 0; i < 50; ++i) {
+                if ((i + t) % 2 == 0) {
+                    MemoryPool::startScavenger(options);
+                } else {
+                    MemoryPool::stopScavenger();
+                }
+            }
+        });
+    }
+    for (auto& controller : controllers) {
+        controller.join();
+    }
+    MemoryPool::stopScavenger();
+    assert(!Scavenger::getInstance()->isRunning());
+    
+    std::cout << "空闲页归还测试通过！" << std::endl;
+}
+
+// 测试 PageCache 与前后相邻的空闲span双向合并
+void testSpanCoalescing() {
+    std::cout << "\n===== 测试span双向合并功能 ======" << std::endl;
+    
+    PageCache* pageCache = PageCache::getInstance();
+    const size_t pages = size_t(1) << 16; // 比此前所有空闲span都大，保证来自新申请的内存
+    const size_t piece = pages / 4;
+    
+    char* base = static_cast<char*>(pageCache->allocateSpan(pages));
+    assert(base != nullptr);
+    pageCache->deallocateSpan(base);
+    
+    // 从同一段空闲内存前部依次切出三个相邻span
+    char* a = static_cast<char*>(pageCache->allocateSpan(piece));
+    char* b = static_cast<char*>(pageCache->allocateSpan(piece));
+    char* c = static_cast<char*>(pageCache->allocateSpan(piece));
+    assert(a == base);
+    assert(b == a + piece * PageCache::PAGE_SIZE);
+    assert(c == b + piece * PageCache::PAGE_SIZE);
+    
+    // 先释放两侧，最后释放中间：中间的span需要同时与前后合并
+    pageCache->deallocateSpan(a);
+    pageCache->deallocateSpan(c);
+    pageCache->deallocateSpan(b);
+    
+    // 整段内存重新合并为一个span
+    void* whole = pageCache->allocateSpan(pages);
+    assert(whole == base);
+    pageCache->deallocateSpan(whole);
+    
+    std::cout << "span双向合并测试通过！" << std::endl;
+}
+
+// 测试页级操作反复进行时，span 与页表节点等元数据被回收复用
+void testMetadataReuse() {
+    std::cout << "\n===== 测试元数据回收复用功能 ======" << std::endl;
+    
+    // 预热一轮，让页表节点和 span 对象池就位
+    std::vector<void*> pointers;
+    for (size_t i = 1; i <= 64; ++i) {
+        pointers.push_back(MemoryPool::allocate(i * 64 * 1024));
+    }
+    for (void* ptr : pointers) {
+        MemoryPool::deallocate(ptr);
+    }
+    
+    size_t before = metadataAllocatedBytes();
+    for (int round = 0; round < 100; ++round) {
+        pointers.clear();
+        for (size_t i = 1; i <= 64; ++i) {
+            pointers.push_back(MemoryPool::allocate(i * 64 * 1024));
+        }
+        for (void* ptr : pointers) {
+            MemoryPool::deallocate(ptr);
+        }
+    }
+    // 分割、合并产生的 span 记录全部复用，不再向系统申请元数据
+    assert(metadataAllocatedBytes() == before);
+    
+    std::cout << "元数据回收复用测试通过！" << std::endl;
+}
+
+// 测试清零分配：新申请的页跳过 memset，复用的脏页仍需清零
+void testZeroedAllocation() {
+    std::cout << "\n===== 测试清零分配功能 ======" << std::endl;
+    
+    auto isZero = [](const void* ptr, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(ptr);
+        for (size_t i = 0; i < size; ++i) {
+            if (bytes[i] != 0) return false;
+        }
+        return true;
+    };
+    
+    const size_t sizes[] = {1, 100, 4096, MAX_BYTES, MAX_BYTES + 1, 4 * 1024 * 1024};
+    for (size_t size : sizes) {
+        for (int round = 0; round < 3; ++round) {
+            void* ptr = MemoryPool::allocateZeroed(size);
+            assert(isZero(ptr, size));
+            // 写脏后释放，下一轮很可能复用同一块内存
+            memset(ptr, 0xAB, size);
+            MemoryPool::deallocate(ptr);
+        }
+    }
+    
+    // 切自新页的小块从未写过，清零分配不会触碰块的其余页
+    const size_t blockSize = 200 * 1024;
+    MemoryPool::flushThreadCache();
+    MemoryPool::releaseFreeMemory();
+    char* fresh = static_cast<char*>(MemoryPool::allocateZeroed(blockSize));
+    uintptr_t lastPage = (reinterpret_cast<uintptr_t>(fresh) + blockSize - 1) & ~(PageCache::PAGE_SIZE - 1);
+    unsigned char resident = 1;
+    int rc = mincore(reinterpret_cast<void*>(lastPage), PageCache::PAGE_SIZE, &resident);
+    assert(rc == 0 && (resident & 1) == 0);
+    assert(isZero(fresh, blockSize));
+    // 写过的块释放后再次清零分配仍完整清零
+    memset(fresh, 0xCD, blockSize);
+    MemoryPool::deallocate(fresh, blockSize);
+    fresh = static_cast<char*>(MemoryPool::allocateZeroed(blockSize));
+    assert(isZero(fresh, blockSize));
+    MemoryPool::deallocate(fresh, blockSize);
+    
+    std::cout << "清零分配测试通过！" << std::endl;
+}
+
+// 测试大对象释放后进入大 span 缓存，同档位的分配直接复用
+void testLargeSpanCache() {
+    std::cout << "\n===== 测试大span缓存功能 ======" << std::endl;
+    
+    PageCache* pageCache = PageCache::getInstance();
+    const size_t size = 3 * 1024 * 1024 + 100; // 约 3MB，落在缓存范围内
+    MemoryPool::releaseFreeMemory(); // 清空此前测试留在缓存中的 span
+    
+    void* first = MemoryPool::allocate(size);
+    // 按档位取整，可用大小不小于请求大小
+    assert(MemoryPool::usableSize(first) >= size);
+    memset(first, 1, size);
+    MemoryPool::deallocate(first);
+    size_t cached = pageCache->getStats().cachedPages;
+    assert(cached >= size / PageCache::PAGE_SIZE);
+    
+    // 大小略有不同但同一档位，命中缓存并拿回同一块内存
+    size_t hits = pageCache->getStats().largeCacheHits;
+    void* second = MemoryPool::allocate(size + 4096);
+    assert(second == first);
+    PageCacheStats stats = pageCache->getStats();
+    assert(stats.largeCacheHits == hits + 1);
+    assert(stats.cachedPages == cached - MemoryPool::usableSize(second) / PageCache::PAGE_SIZE);
+    MemoryPool::deallocate(second);
+    
+    // 缓存有总量上限，大量释放后不会无限增长
+    std::vector<void*> pointers;
+    for (int i = 0; i < 64; ++i) {
+        pointers.push_back(MemoryPool::allocate(size));
+    }
+    for (void* ptr : pointers) {
+        MemoryPool::deallocate(ptr);
+    }
+    assert(pageCache->getStats().cachedPages <= PageCache::LARGE_CACHE_LIMIT_PAGES);
+    
+    // 上限是所有页堆分片合计的，多个线程各自落在不同分片上同样受限
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([size]() {
+            std::vector<void*> local;
+            for (int i = 0; i < 8; ++i) {
+                local.push_back(MemoryPool::allocate(size));
+            }
+            for (void* ptr : local) {
+                MemoryPool::deallocate(ptr);
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    assert(pageCache->getStats().cachedPages <= PageCache::LARGE_CACHE_LIMIT_PAGES);
+    
+    // 缓存为空时一次分配只记一次未命中，不因探查其他分片而重复计数
+    MemoryPool::releaseFreeMemory();
+    size_t misses = pageCache->getStats().largeCacheMisses;
+    void* third = MemoryPool::allocate(5 * 1024 * 1024);
+    assert(pageCache->getStats().largeCacheMisses == misses + 1);
+    MemoryPool::deallocate(third);
+    
+    std::cout << "大span缓存测试通过！" << std::endl;
+}
+
+// 测试大页模式：span 从 2MB 对齐的预留区域中按顺序切出
+void testHugePageMode() {
+    std::cout << "\n===== 测试大页模式功能 ======" << std::endl;
+    
+    PageCache* pageCache = PageCache::getInstance();
+    MemoryPool::setHugePageMode(true);
+    
+    // 比页堆中现有空闲span都大，必然向系统申请，半个区域恰好能切出两次
+    const size_t pages = PageCache::REGION_SIZE / 2 / PageCache::PAGE_SIZE;
+    size_t regions = pageCache->getStats().hugePageRegions;
+    char* a = static_cast<char*>(pageCache->allocateSpan(pages));
+    char* b = static_cast<char*>(pageCache->allocateSpan(pages));
+    assert(a != nullptr && b != nullptr);
+    assert(pageCache->getStats().hugePageRegions == regions + 1);
+    assert(reinterpret_cast<uintptr_t>(a) % PageCache::HUGE_PAGE_SIZE == 0);
+    assert(b == a + pages * PageCache::PAGE_SIZE);
+    
+    // 小对象照常分配使用
+    std::vector<void*> pointers;
+    for (int i = 0; i < 1000; ++i) {
+        void* ptr = MemoryPool::allocate(64);
+        memset(ptr, i & 0xFF, 64);
+        pointers.push_back(ptr);
+    }
+    for (void* ptr : pointers) {
+        MemoryPool::deallocate(ptr, 64);
+    }
+    
+    pageCache->deallocateSpan(a);
+    pageCache->deallocateSpan(b);
+    MemoryPool::setHugePageMode(false);
+    
+    std::cout << "大页模式测试通过！" << std::endl;
+}
+
+// 测试多个页堆分片并发分配、跨线程释放 span
+void testConcurrentPageHeaps() {
+    std::cout << "\n===== 测试页堆分片并发功能 ======" << std::endl;
+    
+    PageCache* pageCache = PageCache::getInstance();
+    const size_t numThreads = PageCache::NUM_HEAPS;
+    const size_t spansPerThread = 200;
+    std::vector<std::vector<std::pair<char*, size_t>>> spans(numThreads);
+    
+    // 各线程使用不同分片分配，并在每个 span 首尾页写入标记
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&, t]() {
+            for (size_t i = 0; i < spansPerThread; ++i) {
+                size_t pages = 1 + (i * 7 + t) % 40;
+                char* ptr = static_cast<char*>(pageCache->allocateSpan(pages));
+                assert(ptr != nullptr);
+                ptr[0] = static_cast<char>(t);
+                ptr[pages * PageCache::PAGE_SIZE - 1] = static_cast<char>(t);
+                spans[t].push_back({ptr, pages});
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    threads.clear();
+    
+    // 每个线程释放另一个线程分配的 span，span 归还到分配它的分片
+    for (size_t t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&, t]() {
+            size_t other = (t + 1) % numThreads;
+            for (auto& [ptr, pages] : spans[other]) {
+                assert(ptr[0] == static_cast<char>(other));
+                assert(ptr[pages * PageCache::PAGE_SIZE - 1] == static_cast<char>(other));
+                pageCache->deallocateSpan(ptr);
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    
+    std::cout << "页堆分片并发测试通过！" << std::endl;
+}
+
+// 测试每 CPU 缓存前端：多线程分配、跨线程释放，归还后 span 全部回到 PageCache
+void testCpuCache() {
+    std::cout << "\n===== 测试每CPU缓存功能 ======" << std::endl;
+    std::cout << "CPU 编号" << (CpuCache::isAvailable() ? "可用" : "不可用，退回线程缓存") << std::endl;
+    
+    MemoryPool::setPerCpuCache(true);
+    const size_t numThreads = 16;
+    const size_t perThread = 500;
+    std::vector<std::vector<std::pair<void*, size_t>>> blocks(numThreads);
+    
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&, t]() {
+            for (size_t i = 0; i < perThread; ++i) {
+                size_t size = 8 + (i * 37 + t * 11) % 5000;
+                char* ptr = static_cast<char*>(MemoryPool::allocate(size));
+                memset(ptr, static_cast<int>(t), size);
+                blocks[t].push_back({ptr, size});
+            }
+            // 释放一半，另一半交给主线程释放
+            for (size_t i = 0; i < perThread / 2; ++i) {
+                MemoryPool::deallocate(blocks[t][i].first, blocks[t][i].second);
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    
+    std::vector<void*> pointers;
+    for (size_t t = 0; t < numThreads; ++t) {
+        for (size_t i = perThread / 2; i < perThread; ++i) {
+            void* ptr = blocks[t][i].first;
+            char* bytes = static_cast<char*>(ptr);
+            assert(bytes[0] == static_cast<char>(t) && bytes[blocks[t][i].second - 1] == static_cast<char>(t));
+            pointers.push_back(ptr);
+            // 交替使用带大小与不带大小的释放
+            if (i % 2 == 0) {
+                MemoryPool::deallocate(ptr, blocks[t][i].second);
+            } else {
+                MemoryPool::deallocate(ptr);
+            }
+        }
+    }
+    
+    // 对齐与清零分配同样走每 CPU 缓存
+    void* aligned = MemoryPool::allocateAligned(100, 64);
+    assert(reinterpret_cast<uintptr_t>(aligned) % 64 == 0);
+    MemoryPool::deallocate(aligned);
+    char* zeroed = static_cast<char*>(MemoryPool::allocateZeroed(300));
+    for (size_t i = 0; i < 300; ++i) assert(zeroed[i] == 0);
+    MemoryPool::deallocate(zeroed, 300);
+    
+    MemoryPool::flushCpuCaches();
+    MemoryPool::flushThreadCache();
+    MemoryPool::setPerCpuCache(false);
+    for (void* ptr : pointers) {
+        Span* span = PageMap::getInstance()->get(ptr);
+        assert(span != nullptr && !span->isUse);
+    }
+    
+    std::cout << "每CPU缓存测试通过！" << std::endl;
+}
+
+// 测试线程缓存预算：超出容量的线程从预算或空闲线程处扩容，合计容量不超过预算太多
+void testThreadCacheBudget() {
+    std::cout << "\n===== 测试线程缓存预算功能 ======" << std::endl;
+    
+    const size_t budget = 2 * 1024 * 1024;
+    MemoryPool::setThreadCacheBudget(budget);
+    // 几个大小类各释放 50 块，合计约 6MB，远超单个线程的容量
+    auto hotLoop = []() {
+        std::vector<std::pair<void*, size_t>> blocks;
+        for (size_t size = 16 * 1024; size <= 32 * 1024; size += 4 * 1024) {
+            for (size_t i = 0; i < 50; ++i) {
+                blocks.push_back({MemoryPool::allocate(size), size});
+            }
+        }
+        for (auto& block : blocks) {
+            MemoryPool::deallocate(block.first, block.second);
+        }
+    };
+    
+    // 空闲线程先扩容，之后一直存活但不再分配
+    std::atomic<bool> grown{false};
+    std::atomic<bool> done{false};
+    size_t idleLimit = 0;
+    size_t idleLimitAfter = 0;
+    std::thread idle([&]() {
+        hotLoop();
+        idleLimit = ThreadCache::getInstance()->maxCacheBytes();
+        grown = true;
+        while (!done) {
+            std::this_thread::yield();
+        }
+        idleLimitAfter = ThreadCache::getInstance()->maxCacheBytes();
+    });
+    while (!grown) {
+        std::this_thread::yield();
+    }
+    
+    // 预算已分完，主线程只能从空闲线程处窃取容量
+    ThreadCache* cache = ThreadCache::getInstance();
+    size_t before = cache->maxCacheBytes();
+    hotLoop();
+    assert(cache->cachedBytes() <= cache->maxCacheBytes());
+    assert(cache->maxCacheBytes() > before);
+    assert(ThreadCache::totalCacheLimit() <= budget + 2 * ThreadCache::MIN_CACHE_BYTES);
+    done = true;
+    idle.join();
+    assert(idleLimit > ThreadCache::MIN_CACHE_BYTES);
+    assert(idleLimitAfter < idleLimit);
+    
+    MemoryPool::setThreadCacheBudget(ThreadCache::DEFAULT_CACHE_BUDGET);
+    MemoryPool::flushThreadCache();
+    std::cout << "线程缓存预算测试通过！" << std::endl;
+}
+
+// 测试自由链表长度上限自适应：反复分配释放同样数量的块后，整轮都在线程缓存内完成
+void testAdaptiveListLength() {
+    std::cout << "\n===== 测试自由链表长度自适应功能 ======" << std::endl;
+    
+    const size_t size = 1024;
+    const size_t live = 80; // 超过原先固定的 64 块阈值
+    size_t index = SizeClass::getIndex(size);
+    ThreadCache* cache = ThreadCache::getInstance();
+    MemoryPool::flushThreadCache();
+    
+    std::vector<void*> pointers(live);
+    for (size_t round = 0; round < 50; ++round) {
+        for (size_t i = 0; i < live; ++i) {
+            pointers[i] = MemoryPool::allocate(size);
+        }
+        for (size_t i = 0; i < live; ++i) {
+            MemoryPool::deallocate(pointers[i], size);
+        }
+    }
+    assert(cache->maxListLength(index) >= live);
+    assert(cache->freeListLength(index) >= live);
+    
+    // 上限稳定后一整轮分配都命中线程缓存
+    size_t before = cache->freeListLength(index);
+    for (size_t i = 0; i < live; ++i) {
+        pointers[i] = MemoryPool::allocate(size);
+    }
+    assert(cache->freeListLength(index) == before - live);
+    for (size_t i = 0; i < live; ++i) {
+        MemoryPool::deallocate(pointers[i], size);
+    }
+    assert(cache->freeListLength(index) == before);
+    
+    MemoryPool::flushThreadCache();
+    assert(cache->freeListLength(index) == 0);
+    std::cout << "自由链表长度自适应测试通过！" << std::endl;
+}
+
+// 测试只释放不分配的线程：反复溢出后链表上限不低于一批，之后的分配仍然成功
+void testFreeHeavyListLength() {
+    std::cout << "\n===== 测试大量释放后的链表上限 ======" << std::endl;
+    
+    const size_t size = 256;
+    const size_t count = 2336;
+    size_t index = SizeClass::getIndex(size);
+    std::vector<void*> pointers;
+    std::thread producer([&]() {
+        for (size_t i = 0; i < count; ++i) {
+            pointers.push_back(MemoryPool::allocate(size));
+        }
+    });
+    producer.join();
+    
+    std::thread consumer([&]() {
+        for (void* ptr : pointers) {
+            MemoryPool::deallocate(ptr, size);
+        }
+        ThreadCache* cache = ThreadCache::getInstance();
+        assert(cache->maxListLength(index) >= SizeClass::numMoveSize(size));
+        void* ptr = MemoryPool::allocate(size);
+        assert(ptr != nullptr);
+        MemoryPool::deallocate(ptr, size);
+    });
+    consumer.join();
+    MemoryPool::flushThreadCache();
+    
+    std::cout << "大量释放后的链表上限测试通过！" << std::endl;
+}
+
+// 测试数组布局的线程缓存：分配释放、跨线程释放和归还与链表布局一致
+void testArrayFreeLists() {
+    std::cout << "\n===== 测试数组布局自由链表功能 ======" << std::endl;
+    
+    MemoryPool::setArrayFreeLists(true);
+    assert(ThreadCache::getInstance()->isArrayMode());
+    
+    // 超过指针数组容量的块数，覆盖批量归还与数组下移
+    const size_t count = ThreadCache::STACK_CAPACITY * 2;
+    std::vector<std::pair<void*, size_t>> blocks;
+    for (size_t i = 0; i < count; ++i) {
+        size_t size = (i % 2 == 0) ? 64 : 8 + (i * 53) % 4000;
+        char* ptr = static_cast<char*>(MemoryPool::allocate(size));
+        memset(ptr, static_cast<int>(i & 0x7f), size);
+        blocks.push_back({ptr, size});
+    }
+    for (size_t i = 0; i < count; ++i) {
+        char* ptr = static_cast<char*>(blocks[i].first);
+        assert(ptr[0] == static_cast<char>(i & 0x7f) && ptr[blocks[i].second - 1] == static_cast<char>(i & 0x7f));
+    }
+    
+    // 新线程同样使用数组布局，并释放一部分主线程分配的块
+    std::thread worker([&blocks, count]() {
+        assert(ThreadCache::getInstance()->isArrayMode());
+        for (size_t i = 0; i < count / 2; ++i) {
+            MemoryPool::deallocate(blocks[i].first, blocks[i].second);
+        }
+        std::vector<void*> local;
+        for (size_t i = 0; i < 1000; ++i) {
+            local.push_back(MemoryPool::allocate(128));
+        }
+        for (void* ptr : local) {
+            MemoryPool::deallocate(ptr, 128);
+        }
+    });
+    worker.join();
+    for (size_t i = count / 2; i < count; ++i) {
+        MemoryPool::deallocate(blocks[i].first, blocks[i].second);
+    }
+    
+    // 切回链表布局时先归还数组中的块，所有 span 都应回到 PageCache
+    MemoryPool::setArrayFreeLists(false);
+    assert(!ThreadCache::getInstance()->isArrayMode());
+    MemoryPool::flushThreadCache();
+    for (auto& block : blocks) {
+        Span* span = PageMap::getInstance()->get(block.first);
+        assert(span != nullptr && !span->isUse);
+    }
+    
+    std::cout << "数组布局自由链表测试通过！" << std::endl;
+}
+
+// 测试 span 惰性切分：新 span 只切出实际领取的块，其余部分保持未切分
+void testLazySpanCarving() {
+    std::cout << "\n===== 测试span惰性切分功能 ======" << std::endl;
+    
+    const size_t size = 16; // 1 页的 span 可切出 256 块，多于单次批量搬运的块数
+    std::vector<void*> pointers;
+    Span* first = nullptr;
+    bool checked = false;
+    for (size_t i = 0; i < 1000; ++i) {
+        void* ptr = MemoryPool::allocate(size);
+        memset(ptr, 0x5a, size);
+        pointers.push_back(ptr);
+        Span* span = PageMap::getInstance()->get(ptr);
+        assert(span != nullptr && span->carvedCount <= span->blockCount && span->useCount <= span->carvedCount);
+        if (first == nullptr) {
+            first = span;
+        } else if (span != first && !checked) {
+            // 第一次拿到新 span 时，它最多只切出了一批
+            assert(span->carvedCount <= MAX_BATCH_NUM && span->carvedCount < span->blockCount);
+            checked = true;
+        }
+    }
+    assert(checked);
+    
+    // 地址互不重叠
+    std::vector<void*> sorted = pointers;
+    std::sort(sorted.begin(), sorted.end());
+    for (size_t i = 1; i < sorted.size(); ++i) {
+        assert(static_cast<char*>(sorted[i]) - static_cast<char*>(sorted[i - 1]) >= static_cast<ptrdiff_t>(size));
+    }
+    
+    // 释放后再分配，切出后归还的块和未切分的块都能正确复用
+    for (size_t i = 0; i < pointers.size(); i += 2) {
+        MemoryPool::deallocate(pointers[i], size);
+    }
+    MemoryPool::flushThreadCache();
+    for (size_t i = 0; i < pointers.size(); i += 2) {
+        pointers[i] = MemoryPool::allocate(size);
+    }
+    for (void* ptr : pointers) {
+        MemoryPool::deallocate(ptr, size);
+    }
+    MemoryPool::flushThreadCache();
+    for (void* ptr : pointers) {
+        Span* span = PageMap::getInstance()->get(ptr);
+        assert(span != nullptr && !span->isUse);
+    }
+    
+    std::cout << "span惰性切分测试通过！" << std::endl;
+}
+
+// 测试按大小类确定 span 页数：末尾浪费不超过 1/8，每个 span 至少能提供一批块
+void testSpanSizing() {
+    std::cout << "\n===== 测试span页数功能 ======" << std::endl;
+    
+    for (size_t index = 0; index < FREE_LIST_SIZE; ++index) {
+        size_t size = SizeClass::classSize(index);
+        size_t spanBytes = SizeClass::spanPages(index) * PageCache::PAGE_SIZE;
+        assert(SizeClass::spanPages(index) >= 1 && SizeClass::spanPages(index) <= PageCache::MAX_PAGES);
+        assert(spanBytes % size <= spanBytes / 8);
+        assert(spanBytes / size >= SizeClass::numMoveSize(size));
+    }
+    
+    // 20KB 的块：固定 8 页时只能切出 1 块，按大小类取页数后没有浪费
+    size_t index = SizeClass::getIndex(20 * 1024);
+    assert(SizeClass::classSize(index) == 20 * 1024);
+    void* ptr = MemoryPool::allocate(20 * 1024);
+    Span* span = PageMap::getInstance()->get(ptr);
+    assert(span != nullptr && span->numPages == SizeClass::spanPages(index));
+    assert(span->blockCount * span->objSize == span->numPages * PageCache::PAGE_SIZE);
+    MemoryPool::deallocate(ptr, 20 * 1024);
+    
+    std::cout << "span页数测试通过！" << std::endl;
+}
+
+// 测试自适应锁：多线程下互斥正确，中心缓存记录各大小类的加锁与竞争次数
+void testAdaptiveLock() {
+    std::cout << "\n===== 测试自适应锁功能 ======" << std::endl;
+    
+    SpinLock lock;
+    const size_t numThreads = 4;
+    const size_t perThread = 20000;
+    size_t counter = 0;
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&]() {
+            for (size_t i = 0; i < perThread; ++i) {
+                std::lock_guard<SpinLock> guard(lock);
+                counter++;
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    assert(counter == numThreads * perThread);
+    LockStats stats = lock.stats();
+    assert(stats.acquisitions == numThreads * perThread);
+    assert(stats.contentions <= stats.acquisitions);
+    assert(lock.try_lock());
+    assert(!lock.try_lock());
+    lock.unlock();
+    
+    // 线程缓存与中心缓存之间的每次搬运都会加一次该大小类的锁
+    size_t index = SizeClass::getIndex(48);
+    uint64_t before = CentralCache::getInstance()->lockStats(index).acquisitions;
+    std::vector<void*> pointers;
+    for (size_t i = 0; i < 1000; ++i) {
+        pointers.push_back(MemoryPool::allocate(48));
+    }
+    for (void* ptr : pointers) {
+        MemoryPool::deallocate(ptr, 48);
+    }
+    MemoryPool::flushThreadCache();
+    LockStats central = CentralCache::getInstance()->lockStats(index);
+    assert(central.acquisitions > before);
+    assert(central.contentions <= central.acquisitions);
+    
+    std::cout << "自适应锁测试通过！" << std::endl;
+}
+
+// 测试传输缓存：一个线程归还的整批原样交给另一个线程，不足一批的搬运直接交给中心缓存
+void testTransferCache() {
+    std::cout << "\n===== 测试传输缓存功能 ======" << std::endl;
+    
+    MemoryPool::flushThreadCache();
+    TransferCache* transfer = TransferCache::getInstance();
+    CentralCache* central = CentralCache::getInstance();
+    const size_t size = 256;
+    size_t index = SizeClass::getIndex(size);
+    size_t batchNum = SizeClass::numMoveSize(size);
+    assert(TransferCache::capacity(index) >= batchNum);
+    assert(TransferCache::capacity(index) % batchNum == 0);
+    
+    // 一个线程归还整批，另一个线程原样取走，期间不经过中心缓存
+    std::vector<void*> produced(batchNum);
+    size_t fetched = 0;
+    RemoteFreeQueue* producerQueue = RemoteFreeQueue::acquire();
+    std::thread producer([&]() {
+        fetched = central->fetchBatch(produced.data(), batchNum, index, producerQueue);
+        transfer->returnBatch(produced.data(), fetched, index);
+    });
+    producer.join();
+    assert(fetched == batchNum);
+    assert(PageMap::getInstance()->get(produced[0])->owner.load() == producerQueue);
+    TransferCacheStats stats = transfer->getStats();
+    assert(stats.cachedBlocks >= batchNum);
+    
+    std::vector<void*> consumed(batchNum);
+    uint64_t lockedBefore = central->lockStats(index).acquisitions;
+    std::thread consumer([&]() {
+        fetched = transfer->fetchBatch(consumed.data(), batchNum, index);
+    });
+    consumer.join();
+    assert(fetched == batchNum);
+    // 转手后领取方释放这些块不会被转给归还方
+    assert(PageMap::getInstance()->get(consumed[0])->owner.load() == nullptr);
+    RemoteFreeQueue::release(producerQueue);
+    assert(central->lockStats(index).acquisitions == lockedBefore);
+    assert(transfer->getStats().removeHits > stats.removeHits);
+    std::vector<void*> sortedProduced = produced;
+    std::vector<void*> sortedConsumed = consumed;
+    std::sort(sortedProduced.begin(), sortedProduced.end());
+    std::sort(sortedConsumed.begin(), sortedConsumed.end());
+    assert(sortedProduced == sortedConsumed);
+    
+    // 链表形式的整批同样暂存，多出的部分原样交还调用方
+    for (size_t i = 0; i + 1 < batchNum; ++i) {
+        *reinterpret_cast<void**>(consumed[i]) = consumed[i + 1];
+    }
+    *reinterpret_cast<void**>(consumed[batchNum - 1]) = nullptr;
+    void* remainder = transfer->returnRange(consumed[0], batchNum * size, index);
+    assert(remainder == nullptr);
+    void* start = nullptr;
+    void* end = nullptr;
+    lockedBefore = central->lockStats(index).acquisitions;
+    fetched = transfer->fetchRange(start, end, batchNum, index);
+    assert(fetched == batchNum);
+    assert(central->lockStats(index).acquisitions == lockedBefore);
+    size_t count = 0;
+    for (void* ptr = start; ptr != nullptr; ptr = *reinterpret_cast<void**>(ptr)) {
+        count++;
+    }
+    assert(count == batchNum);
+    
+    // 不足一批的搬运直接交给中心缓存
+    uint64_t insertsBefore = transfer->getStats().insertHits;
+    void* rest = transfer->returnRange(start, (batchNum - 1) * size, index);
+    assert(rest == end);
+    assert(transfer->getStats().insertHits == insertsBefore);
+    transfer->returnBatch(&rest, 1, index);
+    
+    // 清空后所有块回到 span，span 整体空闲
+    Span* span = PageMap::getInstance()->get(produced[0]);
+    transfer->flush();
+    assert(transfer->getStats().cachedBlocks == 0);
+    central->releaseIdleSpans();
+    assert(!span->isUse);
+    
+    std::cout << "传输缓存测试通过！" << std::endl;
+}
+
+// 测试中心缓存的空闲 span：最后一个块归还后暂留复用，按纪元分批交还 PageCache
+void testIdleSpanReclaim() {
+    std::cout << "\n===== 测试空闲 span 回收功能 ======" << std::endl;
+    
+    CentralCache* central = CentralCache::getInstance();
+    MemoryPool::flushThreadCache();
+    assert(central->idlePages() == 0);
+    
+    // 只归还到中心缓存时，span 留在中心缓存，不交还 PageCache
+    const size_t size = 7000;
+    void* ptr = MemoryPool::allocate(size);
+    Span* span = PageMap::getInstance()->get(ptr);
+    MemoryPool::deallocate(ptr, size);
+    ThreadCache::getInstance()->flush();
+    TransferCache::getInstance()->flush();
+    assert(span->isUse && span->useCount == 0);
+    assert(central->idlePages() >= span->numPages);
+    
+    // 再次分配直接复用该 span
+    ptr = MemoryPool::allocate(size);
+    assert(PageMap::getInstance()->get(ptr) == span);
+    
+    // 同一大小类的另一个 span 也变为空闲时，只留其中一个备用，另一个立即交还 PageCache
+    std::vector<void*> ptrs{ptr};
+    Span* other = nullptr;
+    while (other == nullptr) {
+        void* p = MemoryPool::allocate(size);
+        ptrs.push_back(p);
+        Span* s = PageMap::getInstance()->get(p);
+        if (s != span) {
+            other = s;
+        }
+    }
+    for (void* p : ptrs) {
+        MemoryPool::deallocate(p, size);
+    }
+    ThreadCache::getInstance()->flush();
+    TransferCache::getInstance()->flush();
+    assert(span->isUse != other->isUse);
+    if (!span->isUse) {
+        span = other;
+    }
+    assert(central->idlePages() == span->numPages);
+    
+    // 纪元未推进时不交还，推进后按上限分批交还
+    assert(central->reclaimIdleSpans(1, SIZE_MAX) == 0);
+    assert(span->isUse);
+    central->advanceEpoch();
+    size_t reclaimed = central->reclaimIdleSpans(1, 1);
+    assert(reclaimed == 1);
+    while (central->reclaimIdleSpans(1, 1) != 0) {
+    }
+    assert(!span->isUse);
+    assert(central->idlePages() == 0);
+    
+    std::cout << "空闲 span 回收测试通过！" << std::endl;
+}
+
+// 测试线程缓存析构之后的分配释放：pthread key 析构函数中释放的块直接回到中心缓存，不会滞留
+void testFreeAfterThreadCacheDestroyed() {
+    std::cout << "\n===== 测试线程退出阶段的分配释放 ======" << std::endl;
+    
+    static const size_t size = 13000;
+    pthread_key_t key;
+    int rc = pthread_key_create(&key, [](void* value) {
+        // 此时线程缓存已经析构
+        void* temp = MemoryPool::allocate(size);
+        MemoryPool::deallocate(temp, size);
+        MemoryPool::deallocate(value, size);
+    });
+    assert(rc == 0);
+    
+    void* block = nullptr;
+    std::thread worker([&]() {
+        block = MemoryPool::allocate(size);
+        pthread_setspecific(key, block);
+    });
+    worker.join();
+    pthread_key_delete(key);
+    
+    Span* span = PageMap::getInstance()->get(block);
+    assert(span != nullptr && span->useCount == 0);
+    MemoryPool::flushThreadCache();
+    assert(!span->isUse);
+    
+    std::cout << "线程退出阶段分配释放测试通过！" << std::endl;
+}
+
+// 测试 span 归属：多个线程共享的 span 不再记录归属，线程释放自己分配的块留在本地
+void testSharedSpanOwnership() {
+    std::cout << "\n===== 测试共享 span 的归属 ======" << std::endl;
+    
+    const size_t size = 48;
+    size_t index = SizeClass::getIndex(size);
+    MemoryPool::flushThreadCache();
+    std::vector<void*> pointers;
+    for (size_t i = 0; i < 10; ++i) {
+        pointers.push_back(MemoryPool::allocate(size));
+    }
+    Span* span = PageMap::getInstance()->get(pointers[0]);
+    
+    // 另一个线程从同一个 span 领取块，并在主线程释放期间保持存活
+    std::atomic<bool> fetched{false};
+    std::atomic<bool> done{false};
+    void* other = nullptr;
+    std::thread worker([&]() {
+        other = MemoryPool::allocate(size);
+        fetched = true;
+        while (!done) {
+            std::this_thread::yield();
+        }
+        MemoryPool::deallocate(other, size);
+    });
+    while (!fetched) {
+        std::this_thread::yield();
+    }
+    assert(PageMap::getInstance()->get(other) == span);
+    assert(span->owner.load() == nullptr);
+    
+    size_t before = ThreadCache::getInstance()->freeListLength(index);
+    for (void* ptr : pointers) {
+        MemoryPool::deallocate(ptr, size);
+    }
+    assert(ThreadCache::getInstance()->freeListLength(index) >= before + pointers.size());
+    done = true;
+    worker.join();
+    
+    // 失效与取回剩余块同时完成，之后的压入一律失败
+    RemoteFreeQueue* queue = RemoteFreeQueue::acquire();
+    void* block = MemoryPool::allocate(size);
+    bool pushed = queue->push(block, size);
+    assert(pushed);
+    void* pending = RemoteFreeQueue::release(queue);
+    assert(pending == block);
+    pushed = queue->push(block, size);
+    assert(!pushed && !queue->isAlive());
+    MemoryPool::deallocate(block, size);
+    MemoryPool::flushThreadCache();
+    
+    std::cout << "共享 span 归属测试通过！" << std::endl;
+}
+
 int main() {
     try {
         std::cout << "开始内存池单元测试..." << std::endl;
         
         testBasicAllocation();
+        testSizeClasses();
+        testSizelessDeallocation();
         testTypeSafeAllocation();
         testObjectConstruction();
         testMultithreadedAllocation();
+        testManySpans();
+        testThreadCacheFlush();
+        testCrossThreadDeallocation();
+        testRemoteFreeQueueAccounting();
+        testReleaseFreeMemory();
+        testSpanCoalescing();
+        testMetadataReuse();
+        testZeroedAllocation();
+        testLargeSpanCache();
+        testHugePageMode();
+        testConcurrentPageHeaps();
+        testCpuCache();
+        testThreadCacheBudget();
+        testAdaptiveListLength();
+        testFreeHeavyListLength();
+        testArrayFreeLists();
+        testLazySpanCarving();
+        testSpanSizing();
+        testAdaptiveLock();
+        testTransferCache();
+        testIdleSpanReclaim();
+        testFreeAfterThreadCacheDestroyed();
+        testSharedSpanOwnership();
         
         std::cout << "\n所有单元测试通过！" << std::endl;
         return 0;